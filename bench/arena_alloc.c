@@ -0,0 +1,126 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#include "bench.h"
+
+// The quantity of allocations made before the memory is released
+#define BATCH 1024
+
+// The quantity of allocations made by each cycle
+#define CYCLE_ALLOCS 64
+
+typedef struct Context {
+    uintptr_t size;
+    Arena arena;
+    void *ptrs[BATCH];
+} Context;
+
+static void arena_alloc(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Bench_keep(Arena_alloc(&c->arena, c->size));
+        if (i % BATCH == BATCH - 1) Arena_reset(&c->arena);
+    }
+
+    Arena_reset(&c->arena);
+}
+
+static void arena_alloc_packed(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Bench_keep(Arena_alloc_packed(&c->arena, c->size));
+        if (i % BATCH == BATCH - 1) Arena_reset(&c->arena);
+    }
+
+    Arena_reset(&c->arena);
+}
+
+static void malloc_alloc(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+    uint64_t j;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        j = i % BATCH;
+        c->ptrs[j] = malloc(c->size);
+
+        if (j == BATCH - 1) {
+            for (uint64_t k = 0; k < BATCH; k++) free(c->ptrs[k]);
+        }
+    }
+
+    for (uint64_t k = 0; k < ops % BATCH; k++) free(c->ptrs[k]);
+}
+
+// Each operation is a whole arena lifetime
+static void arena_init_free(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Arena_init(&c->arena);
+
+        for (int j = 0; j < CYCLE_ALLOCS; j++) {
+            Bench_keep(Arena_alloc(&c->arena, c->size));
+        }
+
+        Arena_free(&c->arena);
+    }
+
+    Arena_init(&c->arena);
+}
+
+static void arena_reset_cycle(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        for (int j = 0; j < CYCLE_ALLOCS; j++) {
+            Bench_keep(Arena_alloc(&c->arena, c->size));
+        }
+
+        Arena_reset(&c->arena);
+    }
+}
+
+static void malloc_free_cycle(void *ctx, uint64_t ops) {
+    Context *c = ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        for (int j = 0; j < CYCLE_ALLOCS; j++) c->ptrs[j] = malloc(c->size);
+        for (int j = 0; j < CYCLE_ALLOCS; j++) free(c->ptrs[j]);
+    }
+}
+
+int main(int argc, char **argv) {
+    const uintptr_t sizes[] = { 8, 16, 64, 256, 1024, 4096 };
+    static Context ctx;
+    char name[64];
+    Bench bench;
+
+    Bench_init(&bench, "arena_alloc", argc, argv);
+    Arena_init(&ctx.arena);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        ctx.size = sizes[i];
+
+        snprintf(name, sizeof(name), "arena_alloc/%lu", sizes[i]);
+        Bench_run(&bench, name, arena_alloc, &ctx);
+
+        snprintf(name, sizeof(name), "arena_alloc_packed/%lu", sizes[i]);
+        Bench_run(&bench, name, arena_alloc_packed, &ctx);
+
+        snprintf(name, sizeof(name), "malloc/%lu", sizes[i]);
+        Bench_run(&bench, name, malloc_alloc, &ctx);
+    }
+
+    ctx.size = 48;
+    Bench_run(&bench, "cycle/arena_init_free", arena_init_free, &ctx);
+    Bench_run(&bench, "cycle/arena_reset", arena_reset_cycle, &ctx);
+    Bench_run(&bench, "cycle/malloc_free", malloc_free_cycle, &ctx);
+
+    Arena_free(&ctx.arena);
+    Bench_finish(&bench);
+}
@@ -0,0 +1,62 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+// Recycle regions between arenas
+#define COOL_ARENA_CACHE
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+// The quantity of requests to simulate
+#define REQUESTS 20000
+
+// The quantity of allocations made by each request
+#define ALLOCS 4096
+
+// The size of each allocation
+#define ALLOC_SIZE 64
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+// Simulates requests which each create, fill and free an arena,
+// returning the average time per request in nanoseconds
+static double run(int trim) {
+    volatile uintptr_t sink = 0;
+    double start = now_ns();
+    Arena arena;
+
+    for (int i = 0; i < REQUESTS; i++) {
+        Arena_init(&arena);
+
+        for (int j = 0; j < ALLOCS; j++) {
+            sink += (uintptr_t) Arena_alloc(&arena, ALLOC_SIZE);
+        }
+
+        Arena_free(&arena);
+
+        // Without the cache, every region goes back to libc
+        if (trim) Arena_cache_trim(0);
+    }
+
+    (void) sink;
+    return (now_ns() - start) / REQUESTS;
+}
+
+int main(void) {
+    // Warm up
+    run(0);
+    run(1);
+
+    printf("%10s %14s\n", "cache", "ns/request");
+    printf("%10s %14.2f\n", "off", run(1));
+    printf("%10s %14.2f\n", "on", run(0));
+
+    Arena_cache_trim(0);
+}
@@ -0,0 +1,83 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <time.h>
+
+// Use small regions, so that many regions are created
+#define COOL_ARENA_DEF_SIZE 1024
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+// The quantity of allocations timed at each step
+#define BATCH 100000
+
+// The size of each allocation
+#define ALLOC_SIZE 48
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static uintptr_t count_regions(Arena *arena) {
+    uintptr_t count = 0;
+
+    for (ArenaRegion *r = arena->_head; r != NULL; r = r->_next) {
+        count++;
+    }
+
+    return count;
+}
+
+int main(void) {
+    Arena arena;
+    double start;
+    double elapsed;
+    volatile uintptr_t sink = 0;
+
+    Arena_init(&arena);
+
+    // Time a batch of allocations at each step, as the
+    // quantity of regions in the arena keeps growing
+    printf("%10s %12s\n", "regions", "ns/alloc");
+
+    for (int step = 0; step < 16; step++) {
+        start = now_ns();
+
+        for (int i = 0; i < BATCH; i++) {
+            uintptr_t *mem = Arena_alloc(&arena, ALLOC_SIZE);
+
+            if (mem == NULL) {
+                perror("malloc");
+                Arena_free(&arena);
+                return 1;
+            }
+
+            sink += (uintptr_t) mem;
+        }
+
+        elapsed = now_ns() - start;
+
+        printf(
+            "%10lu %12.2f\n",
+            count_regions(&arena), elapsed / BATCH
+        );
+    }
+
+    // Time refilling every region after a reset
+    Arena_reset(&arena);
+    start = now_ns();
+
+    for (int i = 0; i < 16 * BATCH; i++) {
+        sink += (uintptr_t) Arena_alloc(&arena, ALLOC_SIZE);
+    }
+
+    elapsed = now_ns() - start;
+    printf("%10s %12.2f\n", "reset", elapsed / (16 * BATCH));
+
+    Arena_free(&arena);
+    (void) sink;
+}
@@ -0,0 +1,389 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void *counted_alloc(size_t size);
+static void counted_free(void *ptr);
+
+// Count the memory every backend holds
+#define COOL_ARENA_FUNC_ALLOC counted_alloc
+#define COOL_ARENA_FUNC_FREE counted_free
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+// The most arenas and nested marks which can be replayed at once
+#define MAX_ARENAS 256
+#define MAX_MARKS 64
+
+// The arenas of the synthetic trace, one for each worker
+#define WORKERS 8
+
+// The size of the header used to count each allocation
+#define HEADER_SIZE _Alignof(max_align_t)
+
+typedef struct Trace {
+    ArenaTraceRecord *records;
+    size_t count;
+    size_t alloc;
+} Trace;
+
+typedef struct Slot {
+    uint64_t id;
+    Arena arena;
+
+    // Pointers held by the malloc backend
+    void **ptrs;
+    size_t ptr_count;
+    size_t ptr_alloc;
+
+    uint64_t mark_ids[MAX_MARKS];
+    ArenaMark marks[MAX_MARKS];
+    size_t mark_counts[MAX_MARKS];
+    int mark_depth;
+} Slot;
+
+typedef struct Backend {
+    const char *name;
+
+    // 0 for malloc, otherwise the arena configuration
+    int arena;
+    uintptr_t growth;
+    int reset_flags;
+} Backend;
+
+static Slot slots[MAX_ARENAS];
+static int slot_count;
+
+static size_t live_bytes;
+static size_t peak_bytes;
+
+static void *counted_alloc(size_t size) {
+    char *mem = malloc(size + HEADER_SIZE);
+
+    if (mem == NULL) return NULL;
+
+    memcpy(mem, &size, sizeof(size));
+    live_bytes += size;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+
+    return mem + HEADER_SIZE;
+}
+
+static void counted_free(void *ptr) {
+    char *mem = (char *) ptr - HEADER_SIZE;
+    size_t size;
+
+    if (ptr == NULL) return;
+
+    memcpy(&size, mem, sizeof(size));
+    live_bytes -= size;
+    free(mem);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+// A small deterministic random number generator
+static uint64_t rng_state = 0x2545f4914f6cdd1d;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void push(Trace *trace, uint64_t arena, int op, uint64_t size, uint32_t arg) {
+    if (trace->count == trace->alloc) {
+        trace->alloc = (trace->alloc == 0) ? 1024 : trace->alloc * 2;
+        trace->records = realloc(
+            trace->records, trace->alloc * sizeof(ArenaTraceRecord)
+        );
+        if (trace->records == NULL) exit(1);
+    }
+
+    trace->records[trace->count++] = (ArenaTraceRecord) {
+        .time = 0, .arena = arena, .size = size,
+        .arg = arg, .thread = 1, .op = (uint16_t) op,
+    };
+}
+
+// Builds a trace resembling a server, with an arena per
+// worker which is reset after each request, nested scratch
+// marks, the odd large allocation, and the odd burst of
+// requests which need far more memory than the rest
+static void synthesize(Trace *trace) {
+    uint64_t marks[WORKERS] = { 0 };
+    uint64_t outer = 0;
+    uint64_t inner = 0;
+    uint64_t id;
+    uint64_t size;
+    int allocs;
+
+    for (int worker = 0; worker < WORKERS; worker++) {
+        push(trace, 1 + (uint64_t) worker, COOL_ARENA_TRACE_INIT, 8 * 1024, 0);
+    }
+
+    for (int request = 0; request < 2000; request++) {
+        id = 1 + (uint64_t) (request % WORKERS);
+        allocs = (request % 256 < WORKERS) ? 5000 : 200;
+
+        for (int i = 0; i < allocs; i++) {
+            // Mostly small, sometimes medium, rarely large
+            size = 8 + rng() % 120;
+            if (rng() % 16 == 0) size = 256 + rng() % 2048;
+            if (rng() % 512 == 0) size = 32 * 1024 + rng() % (256 * 1024);
+
+            if (i % 50 == 10) {
+                outer = ++marks[id - 1];
+                push(trace, id, COOL_ARENA_TRACE_MARK, outer, 0);
+            } else if (i % 50 == 20) {
+                inner = ++marks[id - 1];
+                push(trace, id, COOL_ARENA_TRACE_MARK, inner, 0);
+            }
+
+            push(
+                trace, id, COOL_ARENA_TRACE_ALLOC,
+                size, (rng() % 4 == 0) ? 1 : 8
+            );
+
+            if (i % 50 == 30) {
+                push(trace, id, COOL_ARENA_TRACE_REWIND, inner, 0);
+            } else if (i % 50 == 40) {
+                push(trace, id, COOL_ARENA_TRACE_REWIND, outer, 0);
+            }
+        }
+
+        push(trace, id, COOL_ARENA_TRACE_RESET, 0, 0);
+    }
+
+    for (int worker = 0; worker < WORKERS; worker++) {
+        push(trace, 1 + (uint64_t) worker, COOL_ARENA_TRACE_FREE, 0, 0);
+    }
+}
+
+// Reads a trace recorded with `Arena_trace_start`
+static int load(Trace *trace, const char *path) {
+    ArenaTraceRecord record;
+    char magic[8];
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) return -1;
+
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)
+        || memcmp(magic, COOL_ARENA_TRACE_MAGIC, sizeof(magic)) != 0) {
+        fclose(file);
+        return -1;
+    }
+
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        push(trace, record.arena, record.op, record.size, record.arg);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static void release_ptrs(Slot *slot, size_t keep) {
+    while (slot->ptr_count > keep) {
+        counted_free(slot->ptrs[--slot->ptr_count]);
+    }
+}
+
+// Initializes an arena with the region size it was traced with,
+// or the default if it was already in use when the trace started
+static void slot_init(Slot *slot, const Backend *backend, uintptr_t size) {
+    slot->mark_depth = 0;
+    slot->ptr_count = 0;
+
+    if (backend->arena) {
+        Arena_init_ex(
+            &slot->arena, size, backend->growth, COOL_ARENA_MAX_SIZE
+        );
+    }
+}
+
+static void slot_free(Slot *slot, const Backend *backend) {
+    if (backend->arena) Arena_free(&slot->arena);
+    else release_ptrs(slot, 0);
+
+    slot->mark_depth = 0;
+}
+
+static Slot *find(uint64_t id, const Backend *backend) {
+    for (int i = 0; i < slot_count; i++) {
+        if (slots[i].id == id) return &slots[i];
+    }
+
+    // Arenas which were already in use when the
+    // trace started are initialized implicitly
+    if (slot_count == MAX_ARENAS) return NULL;
+
+    slots[slot_count].id = id;
+    slot_init(&slots[slot_count], backend, 0);
+    return &slots[slot_count++];
+}
+
+static void alloc(
+    Slot *slot, const Backend *backend, uint64_t size, uint32_t align
+) {
+    void *mem;
+
+    if (backend->arena) {
+        if (align == 1) mem = Arena_alloc_packed(&slot->arena, size);
+        else mem = Arena_alloc_aligned(&slot->arena, size, align);
+
+        if (mem != NULL) *(char *) mem = 0;
+        return;
+    }
+
+    mem = counted_alloc(size + ((align > HEADER_SIZE) ? align : 0));
+    if (mem == NULL) return;
+    *(char *) mem = 0;
+
+    if (slot->ptr_count == slot->ptr_alloc) {
+        slot->ptr_alloc = (slot->ptr_alloc == 0) ? 256 : slot->ptr_alloc * 2;
+        slot->ptrs = realloc(slot->ptrs, slot->ptr_alloc * sizeof(void *));
+        if (slot->ptrs == NULL) exit(1);
+    }
+
+    slot->ptrs[slot->ptr_count++] = mem;
+}
+
+static void mark(Slot *slot, const Backend *backend, uint64_t id) {
+    if (slot->mark_depth == MAX_MARKS) return;
+
+    slot->mark_ids[slot->mark_depth] = id;
+    slot->mark_counts[slot->mark_depth] = slot->ptr_count;
+    if (backend->arena) slot->marks[slot->mark_depth] = Arena_mark(&slot->arena);
+    slot->mark_depth++;
+}
+
+static void rewind_to(Slot *slot, const Backend *backend, uint64_t id) {
+    // Rewinding to an outer mark skips the inner ones
+    while (slot->mark_depth > 0
+        && slot->mark_ids[slot->mark_depth - 1] != id) {
+        slot->mark_depth--;
+    }
+
+    if (slot->mark_depth == 0) return;
+
+    slot->mark_depth--;
+
+    if (backend->arena) {
+        Arena_rewind(&slot->arena, slot->marks[slot->mark_depth]);
+    } else {
+        release_ptrs(slot, slot->mark_counts[slot->mark_depth]);
+    }
+}
+
+static void reset(Slot *slot, const Backend *backend, int flags) {
+    if (backend->arena) {
+        Arena_reset_ex(&slot->arena, flags | backend->reset_flags);
+    } else {
+        release_ptrs(slot, 0);
+    }
+
+    slot->mark_depth = 0;
+}
+
+// Replays a trace, returning the elapsed time in nanoseconds
+static double replay(const Trace *trace, const Backend *backend) {
+    const ArenaTraceRecord *record;
+    double start = now_ns();
+    Slot *slot;
+
+    for (size_t i = 0; i < trace->count; i++) {
+        record = &trace->records[i];
+        slot = find(record->arena, backend);
+        if (slot == NULL) continue;
+
+        switch (record->op) {
+            case COOL_ARENA_TRACE_INIT:
+                slot_free(slot, backend);
+                slot_init(slot, backend, record->size);
+                break;
+
+            case COOL_ARENA_TRACE_ALLOC:
+                alloc(slot, backend, record->size, record->arg);
+                break;
+
+            case COOL_ARENA_TRACE_RESET:
+                reset(slot, backend, (int) record->arg);
+                break;
+
+            case COOL_ARENA_TRACE_FREE:
+                slot_free(slot, backend);
+                break;
+
+            case COOL_ARENA_TRACE_MARK:
+                mark(slot, backend, record->size);
+                break;
+
+            case COOL_ARENA_TRACE_REWIND:
+                rewind_to(slot, backend, record->size);
+                break;
+        }
+    }
+
+    // Free anything left over
+    for (int i = 0; i < slot_count; i++) {
+        slot_free(&slots[i], backend);
+        free(slots[i].ptrs);
+    }
+
+    memset(slots, 0, sizeof(slots));
+    slot_count = 0;
+
+    return now_ns() - start;
+}
+
+// Replays a trace recorded with `COOL_ARENA_TRACE` (or, without
+// arguments, a synthetic one) against several arena configurations
+// and `malloc(3)`, printing the time taken and memory held by each
+int main(int argc, char **argv) {
+    const Backend backends[] = {
+        { "arena", 1, 1, 0 },
+        { "arena growth 2", 1, 2, 0 },
+        { "arena trim", 1, 1, COOL_ARENA_RESET_TRIM },
+        { "arena consolidate", 1, 1, COOL_ARENA_RESET_CONSOLIDATE },
+        { "malloc", 0, 0, 0 },
+    };
+    Trace trace = { NULL, 0, 0 };
+    double ns;
+
+    if (argc > 1) {
+        if (load(&trace, argv[1]) != 0) {
+            fprintf(stderr, "%s: not an arena trace\n", argv[1]);
+            return 1;
+        }
+    } else {
+        synthesize(&trace);
+    }
+
+    printf("%zu records\n", trace.count);
+    printf("%20s %10s %14s\n", "backend", "ns/op", "peak bytes");
+
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        // Warm up
+        replay(&trace, &backends[i]);
+
+        peak_bytes = live_bytes;
+        ns = replay(&trace, &backends[i]);
+
+        printf(
+            "%20s %10.2f %14zu\n", backends[i].name,
+            ns / (double) trace.count, peak_bytes
+        );
+    }
+
+    free(trace.records);
+}
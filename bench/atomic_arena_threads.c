@@ -0,0 +1,146 @@
+// Needed for clock_gettime(2) and sysconf(3)
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define COOL_ATOMIC_ARENA_IMPL
+#include "../src/atomic_arena.h"
+
+#define COOL_TLAB_IMPL
+#include "../src/tlab.h"
+
+// The quantity of allocations made by each thread
+#define ALLOCS 1000000
+
+// The size of each allocation
+#define ALLOC_SIZE 32
+
+#define MAX_THREADS 256
+
+static AtomicArena atomic_arena;
+static AtomicArena tlab_parent;
+static TlabArena tlab_arena;
+static Arena locked_arena;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static void *atomic_worker(void *arg) {
+    volatile uintptr_t sink = 0;
+    (void) arg;
+
+    for (int i = 0; i < ALLOCS; i++) {
+        sink += (uintptr_t) AtomicArena_alloc(&atomic_arena, ALLOC_SIZE);
+    }
+
+    (void) sink;
+    return NULL;
+}
+
+static void *tlab_worker(void *arg) {
+    volatile uintptr_t sink = 0;
+    (void) arg;
+
+    for (int i = 0; i < ALLOCS; i++) {
+        sink += (uintptr_t) TlabArena_alloc(&tlab_arena, ALLOC_SIZE);
+    }
+
+    (void) sink;
+    return NULL;
+}
+
+static void *locked_worker(void *arg) {
+    volatile uintptr_t sink = 0;
+    (void) arg;
+
+    for (int i = 0; i < ALLOCS; i++) {
+        pthread_mutex_lock(&lock);
+        sink += (uintptr_t) Arena_alloc(&locked_arena, ALLOC_SIZE);
+        pthread_mutex_unlock(&lock);
+    }
+
+    (void) sink;
+    return NULL;
+}
+
+// Runs a worker on a given quantity of threads,
+// returning the elapsed time in nanoseconds
+static double run(void *(*worker)(void *), int count) {
+    pthread_t threads[MAX_THREADS];
+    double start = now_ns();
+
+    for (int i = 0; i < count; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return now_ns() - start;
+}
+
+int main(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double atomic_ns;
+    double tlab_ns;
+    double locked_ns;
+
+    if (cores < 1) cores = 1;
+    if (cores > MAX_THREADS) cores = MAX_THREADS;
+
+    AtomicArena_init(&atomic_arena);
+    AtomicArena_init(&tlab_parent);
+    Arena_init(&locked_arena);
+
+    if (TlabArena_init(&tlab_arena, &tlab_parent, 0) != 0) {
+        perror("pthread_key_create");
+        return 1;
+    }
+
+    // Warm up, so that the regions are reused
+    run(atomic_worker, (int) cores);
+    run(tlab_worker, (int) cores);
+    run(locked_worker, (int) cores);
+
+    printf(
+        "%8s %16s %16s %16s\n",
+        "threads", "atomic Mallocs/s", "tlab Mallocs/s", "mutex Mallocs/s"
+    );
+
+    for (int count = 1;; count <<= 1) {
+        if (count > cores) count = (int) cores;
+
+        AtomicArena_reset(&atomic_arena);
+        TlabArena_reset(&tlab_arena);
+        Arena_reset(&locked_arena);
+
+        atomic_ns = run(atomic_worker, count);
+        tlab_ns = run(tlab_worker, count);
+        locked_ns = run(locked_worker, count);
+
+        printf(
+            "%8d %16.2f %16.2f %16.2f\n", count,
+            (double) count * ALLOCS / atomic_ns * 1e3,
+            (double) count * ALLOCS / tlab_ns * 1e3,
+            (double) count * ALLOCS / locked_ns * 1e3
+        );
+
+        if (count == cores) break;
+    }
+
+    AtomicArena_free(&atomic_arena);
+    TlabArena_free(&tlab_arena);
+    AtomicArena_free(&tlab_parent);
+    Arena_free(&locked_arena);
+}
@@ -0,0 +1,431 @@
+#ifndef _COOL_BENCH_H
+#define _COOL_BENCH_H
+
+/*
+ * A small timing harness shared by the benchmarks.
+ *
+ * Each benchmark is a function which performs a given
+ * quantity of operations. The harness calibrates the quantity
+ * so that each sample takes at least `BENCH_SAMPLE_NS`, runs
+ * a few warmup samples, then times `BENCH_SAMPLES` samples and
+ * reports the minimum, median, 90th and 99th percentile, mean
+ * and standard deviation of the time per operation.
+ *
+ * Results are printed as a table, or as JSON when the
+ * benchmark is run with `--json`. The quantity of samples
+ * can be changed with `--samples N`.
+ *
+ * With `--perf` (on Linux), hardware counters are opened with
+ * `perf_event_open(2)` and counted over the timed samples, and
+ * their counts per operation are reported too. Counters which
+ * can't be opened (such as in containers, or with a strict
+ * `perf_event_paranoid`) are reported as unavailable.
+ *
+ * Needs `_DEFAULT_SOURCE` (or an equivalent feature test
+ * macro) for `clock_gettime(2)`.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 31
+#endif
+
+#ifndef BENCH_WARMUP
+#define BENCH_WARMUP 3
+#endif
+
+#ifndef BENCH_SAMPLE_NS
+#define BENCH_SAMPLE_NS 2000000
+#endif
+
+#define BENCH_MAX_SAMPLES 1024
+
+/**
+ * The hardware counters which can be captured with `--perf`.
+ */
+#define BENCH_PERF_EVENTS 7
+
+static const char *const _bench_perf_names[BENCH_PERF_EVENTS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses",
+    "branch_misses", "dtlb_misses", "ipc",
+};
+
+typedef void (*BenchFunc)(void *ctx, uint64_t ops);
+
+typedef struct Bench {
+    const char *suite;
+    int json;
+    int samples;
+    int count;
+
+    // Whether counters are captured, and their
+    // file descriptors (or -1 when unavailable)
+    int perf;
+    int perf_fds[BENCH_PERF_EVENTS];
+} Bench;
+
+typedef struct BenchResult {
+    uint64_t ops;
+    int samples;
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double mean;
+    double stddev;
+    double cycles;
+
+    // Counts per operation, or NAN when unavailable (the
+    // last being instructions per cycle)
+    double perf[BENCH_PERF_EVENTS];
+} BenchResult;
+
+/**
+ * Stores a value where the compiler can't see it,
+ * so that the work producing it isn't optimized away.
+ */
+static volatile uintptr_t _bench_sink;
+#define Bench_keep(X) (_bench_sink = (uintptr_t) (X))
+
+static inline double Bench_now(void) {
+    struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static inline uint64_t Bench_cycles(void) {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#ifdef __linux__
+
+/**
+ * Opens a counter for the calling thread, counting user space only,
+ * or returns -1 if it can't be opened.
+ */
+static inline int _Bench_perf_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#define _BENCH_CACHE_MISS(C)                  \
+    ((C) | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+#endif // __linux__
+
+/**
+ * Opens every hardware counter which is available.
+ */
+static inline void _Bench_perf_init(Bench *bench) {
+    int opened = 0;
+
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) bench->perf_fds[i] = -1;
+
+#ifdef __linux__
+    // Counters are opened separately rather than as a group,
+    // so that the kernel can multiplex them when there aren't
+    // enough hardware counters for all of them at once
+    bench->perf_fds[0] = _Bench_perf_open(
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES
+    );
+    bench->perf_fds[1] = _Bench_perf_open(
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS
+    );
+    bench->perf_fds[2] = _Bench_perf_open(
+        PERF_TYPE_HW_CACHE, _BENCH_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)
+    );
+    bench->perf_fds[3] = _Bench_perf_open(
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES
+    );
+    bench->perf_fds[4] = _Bench_perf_open(
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES
+    );
+    bench->perf_fds[5] = _Bench_perf_open(
+        PERF_TYPE_HW_CACHE, _BENCH_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB)
+    );
+
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+        if (bench->perf_fds[i] >= 0) opened++;
+    }
+
+    if (opened == 0) {
+        fprintf(
+            stderr, "perf counters unavailable: %s\n", strerror(errno)
+        );
+    }
+#else
+    fprintf(stderr, "perf counters unavailable: not Linux\n");
+#endif
+
+    bench->perf = opened > 0;
+}
+
+static inline void _Bench_perf_start(Bench *bench) {
+#ifdef __linux__
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+        if (bench->perf_fds[i] < 0) continue;
+
+        ioctl(bench->perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(bench->perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void) bench;
+#endif
+}
+
+/**
+ * Stops the counters, and stores their counts per operation.
+ */
+static inline void _Bench_perf_stop(
+    Bench *bench, BenchResult *result, double ops
+) {
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) result->perf[i] = NAN;
+
+#ifdef __linux__
+    uint64_t values[3];
+
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+        if (bench->perf_fds[i] < 0) continue;
+
+        ioctl(bench->perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(bench->perf_fds[i], values, sizeof(values)) != sizeof(values)
+            || values[2] == 0) {
+            continue;
+        }
+
+        // Scale up counts which were multiplexed
+        result->perf[i] = (double) values[0]
+            * ((double) values[1] / (double) values[2]) / ops;
+    }
+
+    result->perf[6] = result->perf[1] / result->perf[0];
+#else
+    (void) bench;
+    (void) ops;
+#endif
+}
+
+static inline void Bench_init(
+    Bench *bench, const char *suite, int argc, char **argv
+) {
+    bench->suite = suite;
+    bench->json = 0;
+    bench->samples = BENCH_SAMPLES;
+    bench->count = 0;
+    bench->perf = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            bench->json = 1;
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            bench->samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            bench->perf = 1;
+        }
+    }
+
+    if (bench->perf) _Bench_perf_init(bench);
+
+    if (bench->samples < 1) bench->samples = 1;
+    if (bench->samples > BENCH_MAX_SAMPLES) bench->samples = BENCH_MAX_SAMPLES;
+
+    if (bench->json) {
+        printf("{\"suite\": \"%s\", \"results\": [", suite);
+    } else {
+        printf("== %s ==\n", suite);
+        printf(
+            "%-32s %10s %10s %10s %10s %10s\n",
+            "benchmark", "min ns", "median ns", "p90 ns", "p99 ns", "cycles"
+        );
+    }
+}
+
+static int _Bench_compare(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Finds a percentile of sorted samples.
+ */
+static inline double _Bench_percentile(double *sorted, int count, int pct) {
+    return sorted[(count - 1) * pct / 100];
+}
+
+/**
+ * Times a benchmark, then reports the result.
+ */
+static inline BenchResult Bench_run(
+    Bench *bench, const char *name, BenchFunc func, void *ctx
+) {
+    double samples[BENCH_MAX_SAMPLES];
+    double total_cycles = 0;
+    double start;
+    double elapsed;
+    uint64_t cycles;
+    BenchResult result;
+
+    // Calibrate, doubling the operations until a sample is long enough
+    result.ops = 1;
+
+    for (;;) {
+        start = Bench_now();
+        func(ctx, result.ops);
+        elapsed = Bench_now() - start;
+
+        if (elapsed >= BENCH_SAMPLE_NS || result.ops >= (uint64_t) 1 << 40) {
+            break;
+        }
+
+        result.ops <<= 1;
+    }
+
+    for (int i = 0; i < BENCH_WARMUP; i++) func(ctx, result.ops);
+
+    result.samples = bench->samples;
+    result.mean = 0;
+
+    if (bench->perf) _Bench_perf_start(bench);
+
+    for (int i = 0; i < result.samples; i++) {
+        cycles = Bench_cycles();
+        start = Bench_now();
+        func(ctx, result.ops);
+        elapsed = Bench_now() - start;
+        cycles = Bench_cycles() - cycles;
+
+        samples[i] = elapsed / (double) result.ops;
+        total_cycles += (double) cycles / (double) result.ops;
+        result.mean += samples[i];
+    }
+
+    if (bench->perf) {
+        _Bench_perf_stop(
+            bench, &result, (double) result.ops * result.samples
+        );
+    }
+
+    result.mean /= result.samples;
+    result.stddev = 0;
+
+    for (int i = 0; i < result.samples; i++) {
+        result.stddev += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+
+    result.stddev = (result.samples > 1)
+        ? sqrt(result.stddev / (result.samples - 1))
+        : 0;
+
+    qsort(samples, (size_t) result.samples, sizeof(double), _Bench_compare);
+
+    result.min = samples[0];
+    result.median = _Bench_percentile(samples, result.samples, 50);
+    result.p90 = _Bench_percentile(samples, result.samples, 90);
+    result.p99 = _Bench_percentile(samples, result.samples, 99);
+    result.cycles = total_cycles / result.samples;
+
+    if (bench->json) {
+        printf(
+            "%s\n  {\"name\": \"%s\", \"ops\": %lu, \"samples\": %d, "
+            "\"min_ns\": %.4f, \"median_ns\": %.4f, \"p90_ns\": %.4f, "
+            "\"p99_ns\": %.4f, \"mean_ns\": %.4f, \"stddev_ns\": %.4f, "
+            "\"cycles\": %.4f",
+            (bench->count > 0) ? "," : "", name,
+            (unsigned long) result.ops, result.samples,
+            result.min, result.median, result.p90,
+            result.p99, result.mean, result.stddev, result.cycles
+        );
+
+        if (bench->perf) {
+            printf(", \"perf\": {");
+
+            for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+                printf("%s\"%s\": ", (i > 0) ? ", " : "", _bench_perf_names[i]);
+
+                if (isnan(result.perf[i])) printf("null");
+                else printf("%.4f", result.perf[i]);
+            }
+
+            printf("}");
+        }
+
+        printf("}");
+    } else {
+        printf(
+            "%-32s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name,
+            result.min, result.median, result.p90, result.p99, result.cycles
+        );
+
+        if (bench->perf) {
+            printf("%-32s", "");
+
+            for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+                if (isnan(result.perf[i])) {
+                    printf(" %s -", _bench_perf_names[i]);
+                } else {
+                    printf(" %s %.3f", _bench_perf_names[i], result.perf[i]);
+                }
+            }
+
+            puts("");
+        }
+    }
+
+    fflush(stdout);
+    bench->count++;
+
+    return result;
+}
+
+static inline void Bench_finish(Bench *bench) {
+    if (bench->json) puts("\n]}");
+
+#ifdef __linux__
+    if (!bench->perf) return;
+
+    for (int i = 0; i < BENCH_PERF_EVENTS; i++) {
+        if (bench->perf_fds[i] >= 0) close(bench->perf_fds[i]);
+    }
+#endif
+}
+
+#endif // _COOL_BENCH_H
@@ -0,0 +1,248 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The most benchmarks which can be compared at once
+#define MAX_RESULTS 1024
+
+typedef struct Result {
+    char suite[64];
+    char name[128];
+    double mean;
+    double stddev;
+    double samples;
+} Result;
+
+typedef struct Results {
+    Result results[MAX_RESULTS];
+    int count;
+} Results;
+
+// Reads a numeric field of a JSON object, within [start, end)
+static double field(const char *start, const char *end, const char *key) {
+    char pattern[64];
+    const char *found;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    found = strstr(start, pattern);
+
+    if (found == NULL || found >= end) return NAN;
+    return strtod(found + strlen(pattern), NULL);
+}
+
+// Reads a string field at the start of a JSON object into a buffer,
+// returning a pointer past the opening quote of its value
+static char *string(char *pos, const char *key, char *buf, size_t size) {
+    char *end;
+
+    pos += strlen(key);
+    end = strchr(pos, '"');
+    if (end == NULL) end = pos + strlen(pos);
+
+    snprintf(buf, size, "%.*s", (int) (end - pos), pos);
+    return pos;
+}
+
+static const Result *find(
+    const Results *results, const char *suite, const char *name
+) {
+    for (int i = 0; i < results->count; i++) {
+        if (strcmp(results->results[i].suite, suite) == 0
+            && strcmp(results->results[i].name, name) == 0) {
+            return &results->results[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Reads the results written by benchmarks run with `--json`,
+// which may be several suites concatenated together. Results are
+// keyed on their suite and name, which must be unique in a file.
+// Returns -1 if the file can't be read, and -2 on a duplicate.
+static int load(const char *path, Results *results) {
+    char *text;
+    char *pos;
+    char *end;
+    char *suite;
+    char current[64] = "";
+    long size;
+    Result *result;
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) return -1;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    text = malloc((size_t) size + 1);
+    if (text == NULL || fread(text, 1, (size_t) size, file) != (size_t) size) {
+        free(text);
+        fclose(file);
+        return -1;
+    }
+
+    text[size] = '\0';
+    fclose(file);
+
+    results->count = 0;
+    suite = strstr(text, "{\"suite\": \"");
+
+    for (pos = strstr(text, "{\"name\": \"");
+        pos != NULL && results->count < MAX_RESULTS;
+        pos = strstr(end, "{\"name\": \"")) {
+        end = strchr(pos, '}');
+        if (end == NULL) break;
+
+        // Results belong to the last suite before them
+        while (suite != NULL && suite < pos) {
+            suite = string(
+                suite, "{\"suite\": \"", current, sizeof(current)
+            );
+            suite = strstr(suite, "{\"suite\": \"");
+        }
+
+        result = &results->results[results->count];
+        snprintf(result->suite, sizeof(result->suite), "%s", current);
+        pos = string(pos, "{\"name\": \"", result->name, sizeof(result->name));
+
+        if (find(results, result->suite, result->name) != NULL) {
+            fprintf(
+                stderr, "%s: duplicate benchmark %s in suite %s\n",
+                path, result->name, result->suite
+            );
+            free(text);
+            return -2;
+        }
+
+        result->mean = field(pos, end, "mean_ns");
+        result->stddev = field(pos, end, "stddev_ns");
+        result->samples = field(pos, end, "samples");
+        results->count++;
+    }
+
+    free(text);
+    return 0;
+}
+
+// Approximates the 97.5th percentile of Student's t-distribution
+// with a given degrees of freedom (Cornish-Fisher expansion)
+static double t_critical(double df) {
+    const double z = 1.959964;
+
+    return z
+        + (z * z * z + z) / (4 * df)
+        + (5 * pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * df * df);
+}
+
+// Compares benchmark results against a baseline with Welch's t-test,
+// printing the change in mean time per operation of each benchmark with
+// a 95% confidence interval. Exits with 1 if any benchmark is slower by
+// more than the threshold (in percent) with 95% confidence.
+//
+// Benchmarks with a single sample on either side have no variance to
+// test, so only the change in their means is compared to the threshold.
+int main(int argc, char **argv) {
+    static Results baseline;
+    static Results current;
+    const Result *old;
+    const Result *new;
+    const char *suite = NULL;
+    double threshold = 5;
+    double diff;
+    double var_old;
+    double var_new;
+    double se;
+    double df;
+    double margin;
+    int argi = 1;
+    int regressions = 0;
+    int rc;
+    const char *status;
+
+    if (argc > 2 && strcmp(argv[1], "--threshold") == 0) {
+        threshold = atof(argv[2]);
+        argi += 2;
+    }
+
+    if (argc - argi != 2) {
+        fprintf(stderr, "usage: %s [--threshold PERCENT] BASELINE CURRENT\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        rc = load(argv[argi + i], (i == 0) ? &baseline : &current);
+
+        if (rc == -1) perror(argv[argi + i]);
+        if (rc != 0) return 2;
+    }
+
+    printf(
+        "%-32s %10s %10s %18s  %s\n",
+        "benchmark", "base ns", "new ns", "change (95% CI)", "status"
+    );
+
+    for (int i = 0; i < current.count; i++) {
+        new = &current.results[i];
+        old = find(&baseline, new->suite, new->name);
+
+        if (suite == NULL || strcmp(suite, new->suite) != 0) {
+            suite = new->suite;
+            printf("== %s ==\n", suite);
+        }
+
+        if (old == NULL) {
+            printf("%-32s %10s %10.2f %18s  new\n", new->name, "-", new->mean, "");
+            continue;
+        }
+
+        diff = new->mean - old->mean;
+
+        if (old->samples > 1 && new->samples > 1) {
+            var_old = old->stddev * old->stddev / old->samples;
+            var_new = new->stddev * new->stddev / new->samples;
+            se = sqrt(var_old + var_new);
+
+            // Welch-Satterthwaite degrees of freedom
+            df = (se > 0)
+                ? (var_old + var_new) * (var_old + var_new) / (
+                    var_old * var_old / (old->samples - 1)
+                    + var_new * var_new / (new->samples - 1)
+                )
+                : 1e9;
+
+            margin = t_critical(df) * se;
+        } else {
+            margin = 0;
+        }
+
+        if ((diff - margin) / old->mean * 100 > threshold) {
+            status = "SLOWER";
+            regressions++;
+        } else if (diff - margin > 0) {
+            status = "slower";
+        } else if (diff + margin < 0) {
+            status = "faster";
+        } else {
+            status = "same";
+        }
+
+        printf(
+            "%-32s %10.2f %10.2f %+8.1f%% +/-%5.1f%%  %s\n",
+            new->name, old->mean, new->mean,
+            diff / old->mean * 100, margin / old->mean * 100, status
+        );
+    }
+
+    if (regressions > 0) {
+        printf(
+            "\n%d benchmark(s) slower than the baseline by more than %g%%\n",
+            regressions, threshold
+        );
+        return 1;
+    }
+
+    return 0;
+}
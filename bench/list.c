@@ -0,0 +1,130 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#include "../src/list.h"
+
+#include "bench.h"
+
+typedef struct Vec4 {
+    double x, y, z, w;
+} Vec4;
+
+ListType(CharList, char);
+ListType(IntList, int);
+ListType(DoubleList, double);
+ListType(Vec4List, Vec4);
+
+// Defines benchmarks for a list of a given type:
+// - push: pushing onto a list which starts small and grows
+// - push_reserved: pushing onto a list which never grows
+// - push_pop: pushing then popping each value
+#define BENCH_LIST(L, T, V)                                  \
+    static void L##_push(void *ctx, uint64_t ops) {          \
+        L list;                                              \
+        (void) ctx;                                          \
+        List_init_sized(list, 8 * sizeof(T));                \
+        for (uint64_t i = 0; i < ops && !list.error; i++) {  \
+            List_push(list, (V));                            \
+        }                                                    \
+        Bench_keep(list.buf);                                \
+        List_free(list);                                     \
+    }                                                        \
+    static void L##_push_reserved(void *ctx, uint64_t ops) { \
+        L list;                                              \
+        (void) ctx;                                          \
+        List_init_sized(list, (ops + 1) * sizeof(T));        \
+        for (uint64_t i = 0; i < ops && !list.error; i++) {  \
+            List_push(list, (V));                            \
+        }                                                    \
+        Bench_keep(list.buf);                                \
+        List_free(list);                                     \
+    }                                                        \
+    static void L##_push_pop(void *ctx, uint64_t ops) {      \
+        L list;                                              \
+        T value;                                             \
+        (void) ctx;                                          \
+        List_init(list);                                     \
+        for (uint64_t i = 0; i < ops && !list.error; i++) {  \
+            List_push(list, (V));                            \
+            value = List_pop(list);                          \
+            Bench_keep(&value);                              \
+        }                                                    \
+        List_free(list);                                     \
+    }
+
+BENCH_LIST(CharList, char, (char) i)
+BENCH_LIST(IntList, int, (int) i)
+BENCH_LIST(DoubleList, double, (double) i)
+BENCH_LIST(Vec4List, Vec4, ((Vec4) { (double) i, 0, 0, 0 }))
+
+// Pushing onto an IntList which grows through an `Allocator`,
+// to compare with the direct calls of IntList/push
+static void IntList_push_allocator(void *ctx, uint64_t ops) {
+    IntList list;
+    List_init_allocator(list, 8 * sizeof(int), (const Allocator *) ctx);
+    for (uint64_t i = 0; i < ops && !list.error; i++) {
+        List_push(list, (int) i);
+    }
+    Bench_keep(list.buf);
+    List_free(list);
+}
+
+// The quantity of values pushed for each "request" below
+#define REQUEST_SIZE 256
+
+// Building and throwing away a small IntList for each operation,
+// as a server might for each request, with malloc(3)...
+static void IntList_request_malloc(void *ctx, uint64_t ops) {
+    IntList list;
+    (void) ctx;
+    for (uint64_t op = 0; op < ops; op++) {
+        List_init_sized(list, 8 * sizeof(int));
+        for (int i = 0; i < REQUEST_SIZE && !list.error; i++) {
+            List_push(list, i);
+        }
+        Bench_keep(list.buf);
+        List_free(list);
+    }
+}
+
+// ...and in an arena, which is reset after each request
+static void IntList_request_arena(void *ctx, uint64_t ops) {
+    Arena *arena = (Arena *) ctx;
+    IntList list;
+    for (uint64_t op = 0; op < ops; op++) {
+        List_init_arena(list, 8 * sizeof(int), arena);
+        for (int i = 0; i < REQUEST_SIZE && !list.error; i++) {
+            List_push(list, i);
+        }
+        Bench_keep(list.buf);
+        Arena_reset(arena);
+    }
+}
+
+#define RUN_LIST(B, L)                                              \
+    Bench_run((B), #L "/push", L##_push, NULL);                     \
+    Bench_run((B), #L "/push_reserved", L##_push_reserved, NULL);   \
+    Bench_run((B), #L "/push_pop", L##_push_pop, NULL)
+
+int main(int argc, char **argv) {
+    Allocator heap = Allocator_malloc();
+    Arena arena;
+    Bench bench;
+
+    Bench_init(&bench, "list", argc, argv);
+    Arena_init(&arena);
+
+    RUN_LIST(&bench, CharList);
+    RUN_LIST(&bench, IntList);
+    Bench_run(&bench, "IntList/push_allocator", IntList_push_allocator, &heap);
+    Bench_run(&bench, "IntList/request_malloc", IntList_request_malloc, NULL);
+    Bench_run(&bench, "IntList/request_arena", IntList_request_arena, &arena);
+    RUN_LIST(&bench, DoubleList);
+    RUN_LIST(&bench, Vec4List);
+
+    Arena_free(&arena);
+    Bench_finish(&bench);
+}
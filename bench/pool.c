@@ -0,0 +1,112 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define COOL_POOL_IMPL
+#include "../src/pool.h"
+
+#include "bench.h"
+
+// The quantity of nodes kept alive by the churn benchmarks
+#define LIVE 4096
+
+typedef struct Node {
+    struct Node *left;
+    struct Node *right;
+    uint64_t key;
+} Node;
+
+PoolType(NodePool, Node);
+
+static Node *live[LIVE];
+
+// A cheap random number generator (xorshift64)
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Allocating then immediately freeing a node
+static void pool_alloc_free(void *ctx, uint64_t ops) {
+    NodePool *pool = (NodePool *) ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Node *node = NodePool_alloc(pool);
+        Bench_keep(node);
+        NodePool_free(pool, node);
+    }
+}
+
+static void malloc_alloc_free(void *ctx, uint64_t ops) {
+    (void) ctx;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Node *node = malloc(sizeof(Node));
+        Bench_keep(node);
+        free(node);
+    }
+}
+
+// Replacing a random node out of a set of live ones, so
+// that nodes are freed in a different order to allocation
+static void pool_churn(void *ctx, uint64_t ops) {
+    NodePool *pool = (NodePool *) ctx;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t slot;
+
+    for (int i = 0; i < LIVE; i++) live[i] = NodePool_alloc(pool);
+
+    for (uint64_t i = 0; i < ops; i++) {
+        slot = next_random(&state) % LIVE;
+        NodePool_free(pool, live[slot]);
+        live[slot] = NodePool_alloc(pool);
+        live[slot]->key = i;
+    }
+
+    for (int i = 0; i < LIVE; i++) NodePool_free(pool, live[i]);
+}
+
+static void malloc_churn(void *ctx, uint64_t ops) {
+    uint64_t state = 88172645463325252ULL;
+    uint64_t slot;
+
+    (void) ctx;
+
+    for (int i = 0; i < LIVE; i++) live[i] = malloc(sizeof(Node));
+
+    for (uint64_t i = 0; i < ops; i++) {
+        slot = next_random(&state) % LIVE;
+        free(live[slot]);
+        live[slot] = malloc(sizeof(Node));
+        live[slot]->key = i;
+    }
+
+    for (int i = 0; i < LIVE; i++) free(live[i]);
+}
+
+int main(int argc, char **argv) {
+    Bench bench;
+    Arena arena;
+    NodePool pool;
+
+    Bench_init(&bench, "pool", argc, argv);
+
+    Arena_init(&arena);
+    NodePool_init(&pool, &arena);
+
+    Bench_run(&bench, "pool/alloc_free", pool_alloc_free, &pool);
+    Bench_run(&bench, "malloc/alloc_free", malloc_alloc_free, NULL);
+    Bench_run(&bench, "pool/churn", pool_churn, &pool);
+    Bench_run(&bench, "malloc/churn", malloc_churn, NULL);
+
+    Arena_free(&arena);
+    NodePool_reset(&pool);
+
+    Bench_finish(&bench);
+}
@@ -0,0 +1,147 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define COOL_SLAB_IMPL
+#include "../src/slab.h"
+
+#include "bench.h"
+
+// The quantity of objects kept alive by the churn benchmarks
+#define LIVE 4096
+
+// The quantity of threads used by the threaded benchmarks
+#define THREADS 4
+
+typedef struct Churn {
+    void *(*alloc)(size_t size);
+    void (*free)(void *ptr);
+    uint64_t ops;
+} Churn;
+
+// A cheap random number generator (xorshift64)
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void *slab_alloc(size_t size) {
+    return Slab_alloc(size);
+}
+
+static void slab_free(void *ptr) {
+    Slab_free(ptr);
+}
+
+// Allocating then immediately freeing objects of a given size
+#define BENCH_SIZE(S)                                         \
+    static void slab_##S(void *ctx, uint64_t ops) {           \
+        (void) ctx;                                           \
+        for (uint64_t i = 0; i < ops; i++) {                  \
+            void *mem = Slab_alloc(S);                        \
+            Bench_keep(mem);                                  \
+            Slab_free(mem);                                   \
+        }                                                     \
+    }                                                         \
+    static void malloc_##S(void *ctx, uint64_t ops) {         \
+        (void) ctx;                                           \
+        for (uint64_t i = 0; i < ops; i++) {                  \
+            void *mem = malloc(S);                            \
+            Bench_keep(mem);                                  \
+            free(mem);                                        \
+        }                                                     \
+    }
+
+BENCH_SIZE(16)
+BENCH_SIZE(64)
+BENCH_SIZE(256)
+BENCH_SIZE(512)
+
+// Replacing a random object out of a set of live ones with
+// one of a random size from 16 to 512 bytes, so that objects
+// are freed in a different order to allocation
+static void *churn(void *arg) {
+    Churn *churn = (Churn *) arg;
+    void *live[LIVE];
+    uint64_t state = 88172645463325252ULL ^ (uintptr_t) &live;
+    uint64_t random;
+
+    for (int i = 0; i < LIVE; i++) live[i] = churn->alloc(16);
+
+    for (uint64_t i = 0; i < churn->ops; i++) {
+        random = next_random(&state);
+        churn->free(live[random % LIVE]);
+
+        live[random % LIVE] = churn->alloc(16 + (random >> 32) % 497);
+        *(char *) live[random % LIVE] = 1;
+    }
+
+    for (int i = 0; i < LIVE; i++) churn->free(live[i]);
+
+    return NULL;
+}
+
+static void slab_churn(void *ctx, uint64_t ops) {
+    Churn args = { slab_alloc, slab_free, ops };
+    (void) ctx;
+    churn(&args);
+}
+
+static void malloc_churn(void *ctx, uint64_t ops) {
+    Churn args = { malloc, free, ops };
+    (void) ctx;
+    churn(&args);
+}
+
+// The same, with each of several threads doing an equal share
+static void threaded_churn(Churn *args) {
+    pthread_t threads[THREADS];
+
+    args->ops /= THREADS;
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, churn, args);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static void slab_churn_threads(void *ctx, uint64_t ops) {
+    Churn args = { slab_alloc, slab_free, ops };
+    (void) ctx;
+    threaded_churn(&args);
+}
+
+static void malloc_churn_threads(void *ctx, uint64_t ops) {
+    Churn args = { malloc, free, ops };
+    (void) ctx;
+    threaded_churn(&args);
+}
+
+#define RUN_SIZE(B, S)                                  \
+    Bench_run((B), "slab/" #S, slab_##S, NULL);         \
+    Bench_run((B), "slab-malloc/" #S, malloc_##S, NULL)
+
+int main(int argc, char **argv) {
+    Bench bench;
+
+    Bench_init(&bench, "slab", argc, argv);
+
+    RUN_SIZE(&bench, 16);
+    RUN_SIZE(&bench, 64);
+    RUN_SIZE(&bench, 256);
+    RUN_SIZE(&bench, 512);
+
+    Bench_run(&bench, "slab/churn", slab_churn, NULL);
+    Bench_run(&bench, "slab-malloc/churn", malloc_churn, NULL);
+    Bench_run(&bench, "slab/churn_threads", slab_churn_threads, NULL);
+    Bench_run(&bench, "slab-malloc/churn_threads", malloc_churn_threads, NULL);
+
+    Bench_finish(&bench);
+}
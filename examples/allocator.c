@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/allocator.h"
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#include "../src/list.h"
+
+ListType(IntList, int);
+
+// An allocator which counts the bytes it has handed out
+static void *counted_alloc(void *ctx, size_t size) {
+    *(size_t *) ctx += size;
+    return malloc(size);
+}
+
+static void *counted_realloc(
+    void *ctx, void *ptr, size_t old_size, size_t new_size
+) {
+    *(size_t *) ctx += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+static void counted_free(void *ctx, void *ptr, size_t size) {
+    if (ptr != NULL) *(size_t *) ctx -= size;
+    free(ptr);
+}
+
+int main(void) {
+    size_t counted = 0;
+    Allocator counter = {
+        counted_alloc, counted_realloc, counted_free, &counted
+    };
+    Arena arena;
+    IntList list;
+
+    // Allocate the regions of an arena with the counting allocator
+    Arena_init_ex(&arena, 1024, 2, 0);
+    Arena_set_allocator(&arena, &counter);
+
+    // Keep a list in the arena, which grows in place
+    // while nothing else is allocated after it
+    List_init_arena(list, 4 * sizeof(int), &arena);
+
+    for (int i = 0; i < 200 && !list.error; i++) List_push(list, i);
+
+    if (list.error) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("list size: %zu, last value: %d\n", list.size, list.buf[list.size - 1]);
+    printf("bytes held by the arena: %zu\n", counted);
+
+    List_free(list);
+    Arena_free(&arena);
+
+    printf("bytes held after freeing: %zu\n", counted);
+
+    return 0;
+}
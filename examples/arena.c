@@ -1,7 +1,7 @@
 #include <string.h>
 
 // Override default size of regions
-#define COOL_ARENA_DEF_SIZE 16
+#define COOL_ARENA_DEF_SIZE 256
 
 #define COOL_ARENA_IMPL
 #include "../src/arena.h"
@@ -9,10 +9,11 @@
 int main(void) {
     char *mem0 = NULL;
     char *mem1 = NULL;
+    char *mem2 = NULL;
+    int *nums = NULL;
     char msg0[] = "Hello, world!";
     char msg1[] = "Yet another hello!";
     Arena arena;
-    Arena *arena_ptr = &arena;
 
     // Initialize an arena
     Arena_init(&arena);
@@ -31,13 +32,40 @@ int main(void) {
     }
     mem1[strlen(msg1)] = '\0';
 
-    // Dump arenas
-    while (arena_ptr != NULL) {
-        puts("");
-        Arena_dump(arena_ptr);
-        arena_ptr = arena_ptr->_next;
+    // Pack a copy of the string into the arena, without
+    // reserving any more bytes than are needed
+    mem2 = Arena_alloc_packed(&arena, strlen(msg0) + 1);
+    memcpy(mem2, msg0, strlen(msg0) + 1);
+
+    // Allocate an array of ints, aligned to a cache line
+    nums = Arena_alloc_aligned(&arena, 4 * sizeof(int), 64);
+    for (int i = 0; i < 4; i++) {
+        nums[i] = i * i;
+    }
+
+    // Or, allocate an array of ints with their natural alignment
+    nums = Arena_new(&arena, int, 4);
+    for (int i = 0; i < 4; i++) {
+        nums[i] = i + 1;
+    }
+
+    // Grow the most recent allocation, which is done in place
+    // if the region has room, and by copying otherwise
+    nums = Arena_realloc(&arena, nums, 4 * sizeof(int), 8 * sizeof(int));
+    for (int i = 4; i < 8; i++) {
+        nums[i] = i + 1;
     }
 
+    // Allocate some temporary memory, then release it
+    // again without resetting the whole arena
+    ArenaMark mark = Arena_mark(&arena);
+    Arena_alloc(&arena, 64);
+    Arena_rewind(&arena, mark);
+
+    // Dump the arena
+    puts("");
+    Arena_dump(&arena);
+
     // Show the string
     puts("");
     puts(mem0);
@@ -46,6 +74,24 @@ int main(void) {
     puts("");
     puts(mem1);
 
+    // Show the packed string
+    puts("");
+    puts(mem2);
+
     // Free the arena
     Arena_free(&arena);
+
+    // Use a stack buffer as the first region of an arena,
+    // so that small allocations never call malloc
+    char buf[256];
+    Arena_init_buffer(&arena, buf, sizeof(buf));
+
+    mem0 = Arena_alloc_packed(&arena, strlen(msg0) + 1);
+    memcpy(mem0, msg0, strlen(msg0) + 1);
+
+    puts("");
+    puts(mem0);
+
+    // Free any regions allocated on overflow
+    Arena_free(&arena);
 }
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <string.h>
+
+// Recycle regions between arenas
+#define COOL_ARENA_CACHE
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+// Handles a request with an arena of its own
+static void handle(int id) {
+    char *msg = NULL;
+    Arena arena;
+
+    Arena_init(&arena);
+
+    // The first region is taken from the cache
+    // when a previous request has freed one
+    msg = Arena_alloc_packed(&arena, 32);
+    if (msg == NULL) {
+        perror("malloc");
+        return;
+    }
+
+    snprintf(msg, 32, "Hello from request %d!", id);
+    printf("%-24s (region %p)\n", msg, (void *) arena._head);
+
+    // The region is returned to the cache
+    Arena_free(&arena);
+}
+
+int main(void) {
+    // Every request reuses the same region
+    for (int i = 0; i < 4; i++) {
+        handle(i);
+    }
+
+    // Free every cached region
+    Arena_cache_trim(0);
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+
+// Enable statistics, to see how much memory the request holds
+#define COOL_STATS
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define SUBTASKS 3
+
+int main(void) {
+    char *results[SUBTASKS];
+    Arena request;
+    Arena subtask;
+    char *scratch;
+    uintptr_t reserved = 0;
+
+    Arena_init(&request);
+
+    for (int i = 0; i < SUBTASKS; i++) {
+        // Each subtask allocates in a child arena, whose
+        // regions are borrowed from the request's arena
+        Arena_init_child(&subtask, &request);
+
+        scratch = (char *) Arena_alloc(&subtask, 64);
+        if (scratch == NULL) {
+            perror("malloc");
+            return 1;
+        }
+
+        snprintf(scratch, 64, "Hello from subtask %d!", i);
+
+        // Keep the result in the request's arena
+        results[i] = (char *) Arena_alloc(&request, strlen(scratch) + 1);
+        if (results[i] != NULL) strcpy(results[i], scratch);
+
+        // Return the subtask's regions to the request,
+        // for the next subtask to use
+        Arena_free(&subtask);
+    }
+
+    for (int i = 0; i < SUBTASKS; i++) {
+        if (results[i] != NULL) puts(results[i]);
+    }
+
+    // Alternate between subtasks with a large allocation and
+    // small ones. Blocks keep their real size when reused, so
+    // the large block is handed back and forth between them,
+    // and the request doesn't allocate any more memory
+    for (int i = 0; i < 100; i++) {
+        Arena_init_child(&subtask, &request);
+
+        if (Arena_alloc(&subtask, (i % 2 == 0) ? 1024 * 1024 : 64) == NULL) {
+            perror("malloc");
+            return 1;
+        }
+
+        Arena_free(&subtask);
+
+        if (i == 1) reserved = Arena_stats(&request).reserved;
+    }
+
+    printf(
+        "Reserved after 100 subtasks: %lu bytes (after 2: %lu)\n",
+        Arena_stats(&request).reserved, reserved
+    );
+
+    if (Arena_stats(&request).reserved != reserved) {
+        fputs("Subtasks stranded memory of the request\n", stderr);
+        Arena_free(&request);
+        return 1;
+    }
+
+    // Free the request, and the memory of every subtask with it
+    Arena_free(&request);
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+
+// Record every arena operation
+#define COOL_ARENA_TRACE
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+int main(void) {
+    const char *ops[] = { "init", "alloc", "reset", "free", "mark", "rewind" };
+    ArenaTraceRecord record;
+    char magic[8];
+    uint64_t last_mark = 0;
+    int repeated = 0;
+    ArenaMark outer;
+    ArenaMark inner;
+    Arena arena;
+    FILE *trace;
+
+    // Record to a temporary file
+    trace = tmpfile();
+    if (trace == NULL || Arena_trace_start(trace) != 0) {
+        perror("tmpfile");
+        return 1;
+    }
+
+    // Use an arena, which is recorded
+    Arena_init(&arena);
+
+    Arena_alloc(&arena, 100);
+    Arena_alloc_packed(&arena, 14);
+
+    // Marks at the same position are still told apart
+    outer = Arena_mark(&arena);
+    inner = Arena_mark(&arena);
+    Arena_alloc_aligned(&arena, 256, 64);
+    Arena_rewind(&arena, inner);
+    Arena_rewind(&arena, outer);
+
+    Arena_reset(&arena);
+    Arena_free(&arena);
+
+    Arena_trace_stop();
+
+    // Read the trace back
+    rewind(trace);
+
+    if (fread(magic, 1, sizeof(magic), trace) != sizeof(magic)) {
+        perror("fread");
+        goto cleanup;
+    }
+
+    printf("%-8s %-8s %-8s %-8s\n", "thread", "op", "size", "arg");
+
+    while (fread(&record, sizeof(record), 1, trace) == 1) {
+        printf(
+            "%-8u %-8s %-8lu %-8u\n",
+            record.thread, ops[record.op],
+            (unsigned long) record.size, record.arg
+        );
+
+        if (record.op == COOL_ARENA_TRACE_MARK) {
+            if (record.size == last_mark) repeated = 1;
+            last_mark = record.size;
+        }
+    }
+
+    if (repeated) {
+        fputs("Two marks were recorded with the same id\n", stderr);
+        fclose(trace);
+        return 1;
+    }
+
+cleanup:
+    fclose(trace);
+}
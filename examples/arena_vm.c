@@ -0,0 +1,110 @@
+// Needed for mmap(2) flags
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+
+// Enable arenas backed by virtual memory
+#define COOL_ARENA_VM
+
+// Enable statistics, to see how much memory is committed
+#define COOL_STATS
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+int main(void) {
+    char *mem0 = NULL;
+    char *mem1 = NULL;
+    char msg[] = "Hello, world!";
+    uintptr_t committed;
+    ArenaMark mark;
+    Arena arena;
+
+    // Reserve 1 GiB of address space, none of
+    // which is committed yet
+    if (Arena_init_vm(&arena, (uintptr_t) 1 << 30, 0) != 0) {
+        perror("mmap");
+        return 1;
+    }
+
+    Arena_dump(&arena);
+
+    // Use the memory (reserving an extra byte for null)
+    mem0 = Arena_alloc_packed(&arena, strlen(msg) + 1);
+    memcpy(mem0, msg, strlen(msg) + 1);
+
+    // Allocate a large block, which commits more
+    // pages directly after the first ones
+    mem1 = (char *) Arena_alloc(&arena, 1024 * 1024);
+    if (mem1 == NULL) {
+        perror("mprotect");
+        goto cleanup;
+    }
+    memset(mem1, 'A', 1024 * 1024);
+
+    puts("");
+    Arena_dump(&arena);
+
+    // Show the string
+    puts("");
+    puts(mem0);
+
+    // Reset the arena, and return its memory to the system
+    Arena_reset(&arena);
+    Arena_decommit(&arena);
+
+    puts("");
+    Arena_dump(&arena);
+
+    // Rewinding reuses the memory committed since the mark,
+    // so repeated savepoints don't commit any more
+    for (int i = 0; i < 1000; i++) {
+        mark = Arena_mark(&arena);
+
+        if (Arena_alloc(&arena, 100) == NULL) {
+            perror("mprotect");
+            goto cleanup;
+        }
+
+        Arena_rewind(&arena, mark);
+
+        if (i == 0) committed = Arena_stats(&arena).capacity;
+    }
+
+    puts("");
+    printf(
+        "Committed after 1000 rewinds: %lu bytes (after 1: %lu)\n",
+        Arena_stats(&arena).capacity, committed
+    );
+
+    if (Arena_stats(&arena).capacity != committed) {
+        fputs("Rewinding leaked committed memory\n", stderr);
+        Arena_free(&arena);
+        return 1;
+    }
+
+    // Growing the most recent allocation past the committed
+    // memory commits more in place, rather than copying it
+    mem0 = (char *) Arena_alloc(&arena, 1000);
+    mem1 = (mem0 == NULL) ? NULL : Arena_realloc(&arena, mem0, 1000, 200000);
+
+    if (mem1 == NULL) {
+        perror("mprotect");
+        goto cleanup;
+    }
+
+    printf(
+        "Grown in place: %s, %lu bytes copied\n",
+        (mem1 == mem0) ? "yes" : "no", Arena_stats(&arena).copied
+    );
+
+    if (mem1 != mem0 || Arena_stats(&arena).copied != 0) {
+        fputs("Growing moved the allocation\n", stderr);
+        Arena_free(&arena);
+        return 1;
+    }
+
+cleanup:
+    // Unmap the arena
+    Arena_free(&arena);
+}
@@ -0,0 +1,53 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define COOL_ATOMIC_ARENA_IMPL
+#include "../src/atomic_arena.h"
+
+#define THREADS 4
+
+static AtomicArena arena;
+static char *msgs[THREADS];
+
+static void *worker(void *arg) {
+    int id = (int) (intptr_t) arg;
+    char msg[] = "Hello from thread 0!";
+
+    msg[18] = (char) ('0' + id);
+
+    // Allocate from the shared arena, without any locking
+    msgs[id] = AtomicArena_alloc(&arena, sizeof(msg));
+    if (msgs[id] != NULL) memcpy(msgs[id], msg, sizeof(msg));
+
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[THREADS];
+
+    // Initialize an arena
+    AtomicArena_init(&arena);
+
+    // Allocate from a few threads at once
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker, (void *) (intptr_t) i);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Dump the arena
+    AtomicArena_dump(&arena);
+
+    // Show the strings
+    puts("");
+    for (int i = 0; i < THREADS; i++) {
+        if (msgs[i] == NULL) perror("malloc");
+        else puts(msgs[i]);
+    }
+
+    // Free the arena
+    AtomicArena_free(&arena);
+}
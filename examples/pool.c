@@ -0,0 +1,75 @@
+#include <stdio.h>
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define COOL_POOL_IMPL
+#include "../src/pool.h"
+
+typedef struct Node {
+    struct Node *next;
+    int value;
+} Node;
+
+// Declare a pool of nodes
+PoolType(NodePool, Node);
+
+int main(void) {
+    Node *head = NULL;
+    Node *node;
+    NodePool pool;
+    Arena arena;
+
+    // Carve the pool's slots out of an arena
+    Arena_init(&arena);
+    NodePool_init(&pool, &arena);
+
+    // Build a linked list
+    for (int i = 0; i < 10; i++) {
+        node = NodePool_alloc(&pool);
+        if (node == NULL) {
+            perror("malloc");
+            return 1;
+        }
+
+        node->value = i;
+        node->next = head;
+        head = node;
+    }
+
+    // Free the odd nodes individually
+    for (Node **link = &head; *link != NULL;) {
+        node = *link;
+
+        if (node->value % 2 == 1) {
+            *link = node->next;
+            NodePool_free(&pool, node);
+        } else {
+            link = &node->next;
+        }
+    }
+
+    printf(
+        "%lu of %lu slots in use\n",
+        NodePool_in_use(&pool), NodePool_capacity(&pool)
+    );
+
+    // Freed slots are reused before new ones are carved out
+    for (int i = 0; i < 5; i++) NodePool_alloc(&pool);
+
+    printf(
+        "%lu of %lu slots in use\n",
+        NodePool_in_use(&pool), NodePool_capacity(&pool)
+    );
+
+    for (node = head; node != NULL; node = node->next) {
+        printf("%d ", node->value);
+    }
+    puts("");
+
+    // Release every slot at once
+    Arena_free(&arena);
+    NodePool_reset(&pool);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <string.h>
+
+#define COOL_SLAB_IMPL
+#include "../src/slab.h"
+
+#include "../src/list.h"
+
+ListType(IntList, int);
+
+int main(void) {
+    char msg[] = "Hello, world!";
+    char *small;
+    char *other;
+    IntList list;
+
+    // Allocate small objects, which share a size class
+    small = Slab_alloc(sizeof(msg));
+    other = Slab_alloc(sizeof(msg));
+
+    if (small == NULL || other == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    memcpy(small, msg, sizeof(msg));
+    puts(small);
+
+    // Objects of the same size class are packed together
+    printf("distance between objects: %td bytes\n", other - small);
+
+    Slab_free(small);
+    Slab_free(other);
+
+    // Keep a list in the slab allocator, which moves
+    // to malloc(3) once it grows past 512 bytes
+    List_init_allocator(list, 4 * sizeof(int), Slab_allocator());
+
+    for (int i = 0; i < 200 && !list.error; i++) List_push(list, i);
+
+    if (list.error) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("list size: %zu, last value: %d\n", list.size, list.buf[list.size - 1]);
+
+    List_free(list);
+
+    return 0;
+}
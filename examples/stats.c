@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+
+// Count allocations in arenas and lists
+#define COOL_STATS
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define COOL_LIST_DEF_SIZE 8
+#include "../src/list.h"
+
+int main(void) {
+    char msg[] = "Hello, world!";
+    uintptr_t sizes[] = { 1024, 2048, 3000, 4080 };
+    char *first;
+    char *shrunk;
+    ArenaStats stats;
+    Arena arena;
+
+    ListType(CharList, char);
+    CharList list;
+
+    // Use an arena for a while
+    Arena_init(&arena);
+
+    for (int cycle = 0; cycle < 4; cycle++) {
+        for (int i = 0; i < 1000; i++) {
+            if (Arena_alloc(&arena, 24 + i % 40) == NULL) {
+                perror("malloc");
+                goto cleanup_arena;
+            }
+        }
+
+        // Some allocations are too large for a region
+        if (Arena_alloc(&arena, 64 * 1024) == NULL) {
+            perror("malloc");
+            goto cleanup_arena;
+        }
+
+        Arena_reset(&arena);
+    }
+
+    // Query the statistics
+    stats = Arena_stats(&arena);
+    printf(
+        "%lu allocations of %lu bytes, peak of %lu bytes in %lu regions\n",
+        stats.allocs, stats.requested, stats.peak, stats.regions
+    );
+
+    // Or export all of them
+    Arena_stats_json(&arena, stdout);
+    Arena_free(&arena);
+
+    // Allocations of an eighth to a half of a region
+    // fill the regions, rather than leaving each one
+    // mostly empty behind
+    puts("");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Arena_init(&arena);
+
+        for (int j = 0; j < 1000; j++) {
+            if (Arena_alloc(&arena, sizes[i]) == NULL) {
+                perror("malloc");
+                goto cleanup_arena;
+            }
+        }
+
+        stats = Arena_stats(&arena);
+        printf(
+            "%lu byte allocations: %lu regions of %lu bytes for %lu bytes\n",
+            sizes[i], stats.regions, stats.capacity, stats.requested
+        );
+
+        if (stats.capacity > stats.requested / 2 * 3 + COOL_ARENA_DEF_SIZE) {
+            fputs("Regions were left mostly empty\n", stderr);
+            Arena_free(&arena);
+            return 1;
+        }
+
+        Arena_free(&arena);
+    }
+
+    // Shrinking an allocation which isn't the most
+    // recent one leaves it in place, copying nothing
+    Arena_init(&arena);
+    first = (char *) Arena_alloc(&arena, 256);
+
+    if (first == NULL || Arena_alloc(&arena, 64) == NULL) {
+        perror("malloc");
+        goto cleanup_arena;
+    }
+
+    shrunk = (char *) Arena_realloc(&arena, first, 256, 128);
+    stats = Arena_stats(&arena);
+
+    printf(
+        "\nShrunk in place: %s, %lu bytes copied\n",
+        (shrunk == first) ? "yes" : "no", stats.copied
+    );
+
+    if (shrunk != first || stats.copied != 0) {
+        fputs("Shrinking moved the allocation\n", stderr);
+        Arena_free(&arena);
+        return 1;
+    }
+
+    Arena_free(&arena);
+
+    // Grow a list
+    List_init(list);
+
+    if (list.error != 0) {
+        perror("malloc");
+        goto cleanup_arena;
+    }
+
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        List_push(list, msg[i]);
+
+        if (list.error != 0) {
+            perror("realloc");
+            goto cleanup_list;
+        }
+    }
+
+    puts("");
+    puts(list.buf);
+    printf("%zu reallocs\n", List_stats(list).reallocs);
+    List_stats_json(list, stdout);
+
+cleanup_list:
+    List_free(list);
+
+cleanup_arena:
+    Arena_free(&arena);
+}
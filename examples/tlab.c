@@ -0,0 +1,96 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define COOL_ATOMIC_ARENA_IMPL
+#include "../src/atomic_arena.h"
+
+#define COOL_TLAB_IMPL
+#include "../src/tlab.h"
+
+#define THREADS 4
+
+static AtomicArena parent;
+static TlabArena arena;
+static char *msgs[THREADS];
+
+static void *worker(void *arg) {
+    int id = (int) (intptr_t) arg;
+    char msg[] = "Hello from thread 0!";
+
+    msg[18] = (char) ('0' + id);
+
+    // Allocate from this thread's own buffer, without any atomics
+    msgs[id] = TlabArena_alloc(&arena, sizeof(msg));
+    if (msgs[id] != NULL) memcpy(msgs[id], msg, sizeof(msg));
+
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[THREADS];
+    char *chunk;
+    char *mem;
+    int reused = 0;
+
+    // Initialize the parent arena, which each thread's buffer is carved from
+    AtomicArena_init(&parent);
+
+    if (TlabArena_init(&arena, &parent, 0) != 0) {
+        perror("pthread_key_create");
+        return 1;
+    }
+
+    // Allocate from a few threads at once
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker, (void *) (intptr_t) i);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Dump the parent, which holds a chunk for each thread
+    AtomicArena_dump(&parent);
+
+    // Show the strings
+    puts("");
+    for (int i = 0; i < THREADS; i++) {
+        if (msgs[i] == NULL) perror("malloc");
+        else puts(msgs[i]);
+    }
+
+    // Release everything every thread allocated at once
+    TlabArena_reset(&arena);
+
+    // The parent may also be reset directly, which discards
+    // the buffer of every thread, rather than letting it
+    // hand out memory the parent hands out again
+    if (TlabArena_alloc(&arena, 16) == NULL) perror("malloc");
+    AtomicArena_reset(&parent);
+
+    mem = TlabArena_alloc(&arena, 16);
+    if (mem == NULL) perror("malloc");
+
+    // Hand out as many chunks as the parent held before
+    for (int i = 0; mem != NULL && i < 2 * THREADS; i++) {
+        chunk = AtomicArena_alloc(&parent, COOL_TLAB_CHUNK_SIZE);
+        if (chunk == NULL) {
+            perror("malloc");
+            break;
+        }
+
+        if (mem >= chunk && mem < chunk + COOL_TLAB_CHUNK_SIZE) reused = 1;
+    }
+
+    if (reused) {
+        fputs("A buffer outlived a reset of its parent\n", stderr);
+        TlabArena_free(&arena);
+        AtomicArena_free(&parent);
+        return 1;
+    }
+
+    // Free the arena, then its parent
+    TlabArena_free(&arena);
+    AtomicArena_free(&parent);
+}
@@ -0,0 +1,91 @@
+// Needed for clock_gettime(2)
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Trace arenas and lists
+#define COOL_TRACE
+
+#define COOL_TRACE_IMPL
+#include "../src/trace.h"
+
+#define COOL_ARENA_IMPL
+#include "../src/arena.h"
+
+#define COOL_LIST_DEF_SIZE 8
+#include "../src/list.h"
+
+#define THREADS 2
+
+ListType(IntList, int);
+
+static void *worker(void *arg) {
+    Arena arena;
+    IntList list;
+
+    (void) arg;
+
+    // A span of our own, which the arena and list spans nest in
+    COOL_TRACE_BEGIN("worker");
+
+    Arena_init_ex(&arena, 256, 2, 0);
+
+    for (int frame = 0; frame < 3; frame++) {
+        for (int i = 0; i < 64; i++) Arena_alloc(&arena, 24);
+        Arena_reset(&arena);
+    }
+
+    Arena_free(&arena);
+
+    List_init(list);
+
+    for (int i = 0; i < 100 && !list.error; i++) List_push(list, i);
+
+    List_free(list);
+
+    COOL_TRACE_END("worker");
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    pthread_t threads[THREADS];
+    char line[256];
+    int events = 0;
+    FILE *trace;
+
+    // Write to a given file, which can be opened in
+    // https://ui.perfetto.dev, or a temporary one
+    trace = (argc > 1) ? fopen(argv[1], "w+") : tmpfile();
+
+    if (trace == NULL || Trace_start(trace) != 0) {
+        perror("fopen");
+        return 1;
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    Trace_stop();
+
+    // Print the events of the first thread
+    rewind(trace);
+
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        if (strstr(line, "\"ph\"") == NULL) continue;
+        events++;
+
+        if (strstr(line, "\"tid\": 1") != NULL) fputs(line, stdout);
+    }
+
+    printf("%d events\n", events);
+
+    fclose(trace);
+    return 0;
+}
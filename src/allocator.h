@@ -0,0 +1,129 @@
+#ifndef _COOL_ALLOCATOR_H
+#define _COOL_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * An allocator which containers can be pointed at
+ * at runtime, such as `malloc(3)` or an arena.
+ *
+ * Each function is passed `ctx`, along with the size
+ * of the allocation being resized or freed, so that
+ * allocators which don't record sizes can be used.
+ *
+ * `alloc` and `realloc` must return NULL on failure, in which
+ * case `realloc` must leave the allocation untouched. `free`
+ * must accept NULL.
+ *
+ * For example:
+ * ```
+ * static void *counted_alloc(void *ctx, size_t size) {
+ *     (*(size_t *) ctx)++;
+ *     return malloc(size);
+ * }
+ *
+ * // ----
+ *
+ * size_t count = 0;
+ * Allocator allocator = {
+ *     counted_alloc, counted_realloc, counted_free, &count
+ * };
+ * ```
+ */
+typedef struct Allocator {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} Allocator;
+
+/**
+ * Allocates memory with an allocator.
+ *
+ * This is inlined, so when the allocator is known at
+ * compile time, the call is made directly.
+ *
+ * @param allocator The allocator to use.
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *Allocator_alloc(const Allocator *allocator, size_t size) {
+    return allocator->alloc(allocator->ctx, size);
+}
+
+/**
+ * Resizes memory allocated with an allocator.
+ *
+ * @param allocator The allocator the memory was allocated with.
+ * @param ptr The allocation, or NULL to allocate.
+ * @param old_size The size of the allocation.
+ * @param new_size The size to resize the allocation to.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *Allocator_realloc(
+    const Allocator *allocator, void *ptr, size_t old_size, size_t new_size
+) {
+    return allocator->realloc(allocator->ctx, ptr, old_size, new_size);
+}
+
+/**
+ * Frees memory allocated with an allocator.
+ *
+ * @param allocator The allocator the memory was allocated with.
+ * @param ptr The allocation, or NULL to do nothing.
+ * @param size The size of the allocation.
+ */
+static inline void Allocator_free(
+    const Allocator *allocator, void *ptr, size_t size
+) {
+    allocator->free(allocator->ctx, ptr, size);
+}
+
+static inline void *_Allocator_malloc_alloc(void *ctx, size_t size) {
+    (void) ctx;
+    return malloc(size);
+}
+
+static inline void *_Allocator_malloc_realloc(
+    void *ctx, void *ptr, size_t old_size, size_t new_size
+) {
+    (void) ctx;
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+static inline void _Allocator_malloc_free(void *ctx, void *ptr, size_t size) {
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+/**
+ * Gets an allocator which uses `malloc(3)`,
+ * `realloc(3)` and `free(3)`.
+ *
+ * For example:
+ * ```
+ * Allocator heap = Allocator_malloc();
+ * char *mem = (char *) Allocator_alloc(&heap, 64);
+ *
+ * // ----
+ *
+ * Allocator_free(&heap, mem, 64);
+ * ```
+ *
+ * @return The allocator.
+ */
+static inline Allocator Allocator_malloc(void) {
+    Allocator allocator = {
+        _Allocator_malloc_alloc,
+        _Allocator_malloc_realloc,
+        _Allocator_malloc_free,
+        NULL
+    };
+
+    return allocator;
+}
+
+#endif // _COOL_ALLOCATOR_H
@@ -4,17 +4,253 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
-typedef struct Arena {
+#include "allocator.h"
+#include "trace.h"
+
+/**
+ * Hints used to keep the fast path of `Arena_alloc`
+ * small, and the refill path out of line.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define COOL_ARENA_LIKELY(X) __builtin_expect(!!(X), 1)
+#define COOL_ARENA_COLD __attribute__((cold, noinline))
+#else
+#define COOL_ARENA_LIKELY(X) (X)
+#define COOL_ARENA_COLD
+#endif
+
+/**
+ * Rounds a size up to a multiple of `sizeof(uintptr_t)`.
+ *
+ * Sizes which are too large to be rounded wrap around to 0.
+ */
+#define COOL_ARENA_ROUND(S) \
+    (((S) + sizeof(uintptr_t) - 1) & ~(uintptr_t) (sizeof(uintptr_t) - 1))
+
+/**
+ * Updates a field of the statistics of an arena,
+ * or does nothing unless `COOL_STATS` is defined.
+ */
+#ifdef COOL_STATS
+#define COOL_ARENA_STAT(A, F, N) ((A)->_stats.F += (N))
+#else
+#define COOL_ARENA_STAT(A, F, N) ((void) 0)
+#endif
+
+typedef struct ArenaRegion {
     uintptr_t *_region;
     uintptr_t _size;
     uintptr_t _alloc_size;
-    struct Arena *_next;
+    struct ArenaRegion *_next;
+} ArenaRegion;
+
+#ifdef COOL_STATS
+
+/**
+ * Statistics about how an arena has been used since it
+ * was initialized, returned by `Arena_stats`.
+ *
+ * This is only available if `COOL_STATS` is defined.
+ */
+typedef struct ArenaStats {
+    // The quantity of allocations, and of bytes requested by them
+    uintptr_t allocs;
+    uintptr_t requested;
+
+    // The quantity of calls to `Arena_realloc` which had to move
+    // the memory, and of bytes copied by them
+    uintptr_t reallocs;
+    uintptr_t copied;
+
+    // The quantity of regions and large blocks allocated,
+    // and of bytes reserved by them (including headers)
+    uintptr_t region_allocs;
+    uintptr_t large_allocs;
+    uintptr_t reserved;
+
+    // The quantity of bytes left free at the end
+    // of regions when they were retired
+    uintptr_t wasted;
+
+    // The quantity of resets
+    uintptr_t resets;
+
+    // The quantity of regions currently held, their
+    // capacity, and how many bytes of it are in use
+    uintptr_t regions;
+    uintptr_t capacity;
+    uintptr_t in_use;
+
+    // The most bytes in use seen at a reset or by `Arena_stats`
+    uintptr_t peak;
+} ArenaStats;
+
+#endif // COOL_STATS
+
+typedef struct Arena {
+    char *_ptr;
+    char *_end;
+    ArenaRegion *_head;
+    ArenaRegion *_current;
+    ArenaRegion *_buffer;
+    ArenaRegion *_large;
+    uintptr_t _def_size;
+    uintptr_t _next_size;
+    uintptr_t _growth;
+    uintptr_t _max_size;
+    uintptr_t _retire;
+    uintptr_t _peak;
+    uintptr_t _retain;
+    uintptr_t _marks;
+    const Allocator *_allocator;
+    Allocator _self;
+    Allocator _borrow;
+    ArenaRegion *_spare;
+    char *_vm_base;
+    char *_vm_commit;
+    char *_vm_limit;
+    char *_vm_packed;
+    uintptr_t _vm_granule;
+#ifdef COOL_STATS
+    ArenaStats _stats;
+#endif
 } Arena;
 
+typedef struct ArenaMark {
+    char *_ptr;
+    char *_end;
+    ArenaRegion *_head;
+    ArenaRegion *_current;
+    ArenaRegion *_large;
+    char *_vm_packed;
+
+    // Numbers the marks of an arena, so traces can tell them apart
+    uintptr_t _id;
+} ArenaMark;
+
+/**
+ * The operations recorded in an arena trace.
+ */
+#define COOL_ARENA_TRACE_INIT 0
+#define COOL_ARENA_TRACE_ALLOC 1
+#define COOL_ARENA_TRACE_RESET 2
+#define COOL_ARENA_TRACE_FREE 3
+#define COOL_ARENA_TRACE_MARK 4
+#define COOL_ARENA_TRACE_REWIND 5
+
+/**
+ * The 8 bytes at the start of every arena trace.
+ */
+#define COOL_ARENA_TRACE_MAGIC "COOLTRC1"
+
+/**
+ * A single record of an arena trace, in the
+ * byte order of the machine which recorded it.
+ *
+ * For each operation:
+ * - `COOL_ARENA_TRACE_INIT`: `size` is the region size.
+ * - `COOL_ARENA_TRACE_ALLOC`: `size` is the quantity of bytes
+ *   requested, and `arg` is the alignment (1 for packed memory).
+ * - `COOL_ARENA_TRACE_RESET`: `arg` holds the flags.
+ * - `COOL_ARENA_TRACE_MARK` and `COOL_ARENA_TRACE_REWIND`:
+ *   `size` identifies the mark, counting up from 1 for each
+ *   mark of the arena since it was initialized.
+ *
+ * Traces are only recorded if `COOL_ARENA_TRACE` is defined,
+ * but can be read without it.
+ */
+typedef struct ArenaTraceRecord {
+    // Nanoseconds since `Arena_trace_start`
+    uint64_t time;
+
+    // The address of the arena
+    uint64_t arena;
+
+    uint64_t size;
+    uint32_t arg;
+
+    // A small number identifying the recording thread
+    uint16_t thread;
+
+    uint16_t op;
+} ArenaTraceRecord;
+
+#ifdef COOL_ARENA_TRACE
+
+/**
+ * Starts recording every `Arena_init`, allocation,
+ * `Arena_mark`, `Arena_rewind`, `Arena_reset` and `Arena_free`
+ * of every arena to a stream, as a compact binary trace.
+ *
+ * The trace starts with `COOL_ARENA_TRACE_MAGIC`, followed by
+ * an `ArenaTraceRecord` for each operation. Each record is
+ * written with a single `fwrite(3)`, so threads may record
+ * to the same stream concurrently.
+ *
+ * Recording adds a function call to every allocation,
+ * so is only compiled in if `COOL_ARENA_TRACE` is defined.
+ * Operations are timed with a monotonic clock, which needs
+ * `_DEFAULT_SOURCE` (or an equivalent feature test macro)
+ * for `clock_gettime(2)`. `bench/arena_replay.c` replays a trace against
+ * different arena configurations and `malloc(3)`.
+ *
+ * This should not be called while other threads are
+ * using arenas.
+ *
+ * For example:
+ * ```
+ * FILE *trace = fopen("arena.trace", "wb");
+ *
+ * if (trace == NULL || Arena_trace_start(trace) != 0) {
+ *     perror("fopen");
+ * }
+ *
+ * // ----
+ *
+ * Arena_trace_stop();
+ * fclose(trace);
+ * ```
+ *
+ * @param stream The stream to record to.
+ * @return 0 on success, -1 otherwise.
+ */
+int Arena_trace_start(FILE *stream);
+
+/**
+ * Stops recording the trace started by `Arena_trace_start`,
+ * flushing the stream. The stream is not closed.
+ *
+ * This should not be called while other threads are
+ * using arenas.
+ */
+void Arena_trace_stop(void);
+
+/**
+ * Records an operation on an arena, if a trace is being recorded.
+ *
+ * This is called by the arena itself, and should
+ * not be called directly.
+ */
+void _Arena_trace(Arena *arena, int op, uintptr_t size, uintptr_t arg);
+
+#define COOL_ARENA_TRACE_EVENT(A, O, S, G) _Arena_trace((A), (O), (S), (G))
+
+#else
+
+#define COOL_ARENA_TRACE_EVENT(A, O, S, G) ((void) 0)
+
+#endif // COOL_ARENA_TRACE
+
 /**
  * Initializes an `Arena` struct.
  *
+ * Every region of the arena will be allocated with
+ * `COOL_ARENA_DEF_SIZE` bytes, growing by a factor of
+ * `COOL_ARENA_GROWTH` up to `COOL_ARENA_MAX_SIZE` bytes.
+ * See `Arena_init_ex` to choose these for each arena.
+ *
  * For example:
  * ```
  * Arena arena;
@@ -28,91 +264,180 @@ typedef struct Arena {
 void Arena_init(Arena *arena);
 
 /**
- * Allocates a given quantity of memory
- * within the arena.
+ * Initializes an `Arena` struct, using memory supplied
+ * by the caller (such as a stack or static buffer)
+ * as its first region.
  *
- * If there is a region with enough free memory,
- * then that region will be used for allocation.
+ * The start of the buffer is used for the header of the
+ * region. Allocations which fit in the buffer never allocate
+ * memory, so the arena can be used where `malloc(3)` can't,
+ * such as in signal handlers. Once the buffer is full, regions
+ * are allocated as usual (see `Arena_init`).
  *
- * If no regions have enough memory available and the
- * memory being allocated is less than `COOL_ARENA_DEF_SIZE`,
- * then a new region will be allocated of size `COOL_ARENA_DEF_SIZE`.
+ * The buffer is never freed by the arena, and is kept by
+ * `Arena_reset_ex` regardless of the retention budget.
+ * After `Arena_free`, the arena no longer uses the buffer.
  *
- * If no regions have enough memory available and the
- * memory being allocated is greater than `COOL_ARENA_DEF_SIZE`,
- * then a region will be allocated. In this case, however,
- * the allocator will start at size `COOL_ARENA_DEF_SIZE` and keep
- * doubling this size, until a value which is larger than the requested
- * size `size` is reached. A new region will then be allocated with this size.
+ * If the buffer is too small to hold a region,
+ * it is ignored.
  *
  * For example:
  * ```
+ * char buf[4096];
  * Arena arena;
+ * Arena_init_buffer(&arena, buf, sizeof(buf));
  *
  * // ----
  *
- * char *mem = (char *) Arena_alloc(&arena, 1024);
+ * // Regions may have been allocated on overflow
+ * Arena_free(&arena);
+ * ```
  *
- * // Check for failure
- * if (mem == NULL) {
- *     perror("malloc");
- * }
+ * @param arena The arena to initialize.
+ * @param buf The buffer to use.
+ * @param size The size of the buffer in bytes.
+ */
+void Arena_init_buffer(Arena *arena, void *buf, uintptr_t size);
+
+/**
+ * Initializes an `Arena` struct with a given
+ * region size and growth policy.
+ *
+ * The first region of the arena will be allocated with
+ * `size` bytes, and each new region after it will be `growth`
+ * times larger than the previous one, until `max_size` bytes
+ * is reached. This way, arenas which hold a lot of memory
+ * quickly reach large regions, while small arenas stay small.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // Start with 4 KiB regions, doubling in
+ * // size up to regions of 16 MiB
+ * Arena_init_ex(&arena, 4096, 2, 16 * 1024 * 1024);
  *
  * // ----
  * ```
  *
- * @param arena The arena to allocate memory in.
- * @param size The quantity of bytes to allocate.
- * @return A pointer on success, NULL otherwise.
+ * @param arena The arena to initialize.
+ * @param size The size of the first region in bytes, including
+ *             its header. If 0, `COOL_ARENA_DEF_SIZE` is used.
+ * @param growth The factor to grow each new region by. If 0, 1 is used.
+ * @param max_size The maximum size of a new region in bytes, unless
+ *                 a single allocation needs a larger region. If less
+ *                 than `size`, `size` is used.
  */
-uintptr_t *Arena_alloc(Arena *arena, uintptr_t size);
+void Arena_init_ex(
+    Arena *arena, uintptr_t size, uintptr_t growth, uintptr_t max_size
+);
 
 /**
- * Resets the arena.
+ * Initializes an `Arena` struct as a child of another
+ * arena, which takes its regions (and large blocks)
+ * from the parent, rather than `COOL_ARENA_FUNC_ALLOC`.
  *
- * All currently allocated regions will remain, but
- * they will be reset, so that memory can be allocated within
- * them once more.
+ * Regions released by the child, when it is freed or trimmed,
+ * are returned to the parent, and handed to the next child
+ * which needs one. This way, short-lived children (such as one
+ * for each subtask of a request) allocate nothing from the
+ * system once the parent has enough memory, and the parent
+ * remains the single point of teardown.
  *
- * This does not reset the memory in the regions.
+ * The regions of the child are a quarter of the size of the
+ * regions of the parent, growing in the same way, so that
+ * several fit in each region of the parent.
+ *
+ * The child must be freed before the parent is reset,
+ * rewound or freed, which releases the memory of every child.
+ * Children may have children of their own.
  *
  * For example:
  * ```
- * Arena arena;
+ * Arena request;
+ * Arena subtask;
+ *
+ * Arena_init(&request);
  *
  * // ----
  *
- * Arena_reset(&arena);
+ * // For each subtask
+ * Arena_init_child(&subtask, &request);
+ *
+ * // ----
+ *
+ * Arena_free(&subtask);
  *
  * // ----
+ *
+ * Arena_free(&request);
  * ```
  *
- * @param arena The arena to reset.
+ * @param child The arena to initialize.
+ * @param parent The arena to take regions from.
  */
-void Arena_reset(Arena *arena);
+void Arena_init_child(Arena *child, Arena *parent);
+
+#ifdef COOL_ARENA_VM
 
 /**
- * Frees the arena.
+ * A flag for `Arena_init_vm`, requesting that
+ * the arena is backed by huge pages.
+ */
+#define COOL_ARENA_VM_HUGE 1
+
+/**
+ * Initializes an `Arena` struct backed by a single
+ * contiguous range of reserved virtual memory,
+ * instead of a chain of regions.
  *
- * Each region will individually be freed and
- * the root of the arena will be reinitialized.
+ * The whole range is reserved up front with `mmap(2)`,
+ * but pages are only committed (made accessible) as the
+ * bump pointer advances, `COOL_ARENA_VM_COMMIT_SIZE` bytes
+ * at a time. Allocations beyond the reserved range fail.
+ *
+ * If `COOL_ARENA_VM_HUGE` is passed, the range is first
+ * reserved with `MAP_HUGETLB`, which needs enough huge pages to
+ * be available for the whole range. If that fails, a normal range
+ * aligned to `COOL_ARENA_VM_HUGE_SIZE` is reserved instead,
+ * and marked with `madvise(MADV_HUGEPAGE)` so that transparent
+ * huge pages can be used. Memory is then committed
+ * `COOL_ARENA_VM_HUGE_SIZE` bytes at a time.
+ *
+ * This is only available if `COOL_ARENA_VM` is defined,
+ * and requires `_DEFAULT_SOURCE` (or an equivalent feature
+ * test macro) to be defined before any headers are included.
  *
  * For example:
  * ```
  * Arena arena;
  *
- * // ----
- *
- * Arena_free(&arena);
+ * // Reserve 1 GiB of address space
+ * if (Arena_init_vm(&arena, (uintptr_t) 1 << 30, 0) != 0) {
+ *     perror("mmap");
+ * }
  *
+ * // ----
  * ```
+ *
+ * @param arena The arena to initialize.
+ * @param reserve The quantity of bytes to reserve.
+ * @param flags 0, or `COOL_ARENA_VM_HUGE`.
+ * @return 0 on success, -1 otherwise (with `errno` set).
  */
-void Arena_free(Arena *arena);
+int Arena_init_vm(Arena *arena, uintptr_t reserve, int flags);
 
 /**
- * Dumps the arena to stdout.
+ * Returns the free committed memory of an arena
+ * initialized with `Arena_init_vm` to the system.
  *
- * Quite useful for debugging.
+ * Free pages are released with `madvise(MADV_DONTNEED)`,
+ * and those at the end of the committed memory are
+ * decommitted entirely. Pages are committed again as
+ * they are needed.
+ *
+ * Pairing this with `Arena_reset` releases all of the
+ * memory of the arena, while keeping its address range.
  *
  * For example:
  * ```
@@ -120,182 +445,2482 @@ void Arena_free(Arena *arena);
  *
  * // ----
  *
- * Arena_dump(&arena);
+ * Arena_reset(&arena);
+ * Arena_decommit(&arena);
  *
  * // ----
- *
  * ```
+ *
+ * @param arena The arena to decommit memory for.
  */
-void Arena_dump(Arena *arena);
+void Arena_decommit(Arena *arena);
 
-#ifdef COOL_ARENA_IMPL
+#endif // COOL_ARENA_VM
+
+#ifdef COOL_ARENA_CACHE
 
 /**
- * The default quantity of bytes to allocate
- * to each region in the arena.
+ * Frees memory held by the region cache, which recycles
+ * the regions of arenas across the whole process.
+ *
+ * With `COOL_ARENA_CACHE` defined, regions freed by any arena
+ * (such as by `Arena_free`) are kept in a cache instead of being
+ * freed, and new regions are taken from the cache when possible.
+ * This saves a round trip to the underlying allocator when
+ * arenas are created and freed often, such as one per request.
+ *
+ * Each thread caches up to `COOL_ARENA_CACHE_LOCAL_MAX` regions of
+ * each size class without locking. The rest go to a global pool of
+ * at most `COOL_ARENA_CACHE_MAX` bytes, which is shared by every
+ * thread. A thread's cached regions are moved to the global pool
+ * when it exits.
+ *
+ * This moves the calling thread's cached regions to the global
+ * pool, then frees regions from the pool until it holds at most
+ * a given quantity of bytes.
+ *
+ * This is only available if `COOL_ARENA_CACHE` is defined.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_free(&arena);
+ *
+ * // Free every cached region
+ * Arena_cache_trim(0);
+ * ```
+ *
+ * @param size The quantity of bytes to keep in the global pool.
  */
-#ifndef COOL_ARENA_DEF_SIZE
-#define COOL_ARENA_DEF_SIZE 8 * 1024
-#endif
+void Arena_cache_trim(uintptr_t size);
+
+#endif // COOL_ARENA_CACHE
 
 /**
- * The underlying function for allocating
- * memory for Arena structs and regions.
+ * Refills the arena, then allocates a given
+ * quantity of memory within it.
  *
- * This function can be changed, but it must have
- * the same function signature as `malloc(3)`.
+ * This is the out of line slow path of the `Arena_alloc`
+ * family of functions, and is only called when the current
+ * region does not have enough free memory.
+ * It should not be called directly.
  *
- * This function must also return a valid pointer
- * on success, and NULL on failure.
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate, which must
+ *             be a multiple of `sizeof(uintptr_t)`, unless
+ *             `align` is 1.
+ * @param align The alignment of the allocation, which must be
+ *              a power of two. An alignment of 1 allocates
+ *              from the top of a region, see `Arena_alloc_packed`.
+ * @return A pointer on success, NULL otherwise.
  */
-#ifndef COOL_ARENA_FUNC_ALLOC
-#include <stdlib.h>
-#define COOL_ARENA_FUNC_ALLOC malloc
-#endif
+COOL_ARENA_COLD void *_Arena_refill(Arena *arena, uintptr_t size, uintptr_t align);
 
 /**
- * The underlying function for freeing
- * memory for a region.
+ * Extends the most recent allocation of an arena initialized
+ * with `Arena_init_vm` past the committed memory, by committing
+ * more of the reserved range.
  *
- * This function can be changed, but it must have
- * the same function signature as `free(3)`
+ * This is the out of line slow path of `Arena_extend`.
+ * It should not be called directly.
+ *
+ * @param arena The arena the allocation is in.
+ * @param ptr The allocation, which must be the most recent one.
+ * @param size The size to extend the allocation to, which must
+ *             be a multiple of `sizeof(uintptr_t)`.
+ * @return 1 if the allocation was extended, 0 otherwise.
  */
-#ifndef COOL_ARENA_FUNC_FREE
-#include <stdlib.h>
-#define COOL_ARENA_FUNC_FREE free
-#endif
-
-void Arena_init(Arena *arena) {
-    arena->_region = NULL;
-    arena->_size = 0;
-    arena->_alloc_size = 0;
-    arena->_next = NULL;
-}
-
-uintptr_t *Arena_alloc(Arena *arena, uintptr_t size) {
-    uintptr_t new_capacity;
-    uintptr_t *mem = NULL;
-    uintptr_t *new_region;
-    Arena *new_arena;
-
-    // If size is 0, do nothing
-    if (size == 0) return NULL;
+COOL_ARENA_COLD int _Arena_extend_vm(Arena *arena, char *ptr, uintptr_t size);
 
-    // Switch size to accomodate bytes
-    size = (size >> 2) + 1;
+/**
+ * Allocates a given quantity of memory
+ * within the arena.
+ *
+ * The size is rounded up to a multiple of `sizeof(uintptr_t)`.
+ *
+ * The arena keeps a bump pointer into its current region.
+ * If the current region has enough free memory,
+ * then it will be used for allocation, which is only
+ * a comparison and an increment of the bump pointer.
+ * This fast path is inlined at each call site.
+ *
+ * Otherwise, the arena is refilled out of line, and one
+ * of the following happens:
+ * - If the current region still has at least
+ *   1 / `COOL_ARENA_RETIRE_RATIO` of the arena's region size
+ *   free, and more free than the region the allocation goes in
+ *   would have left, it is kept as the current region, and the
+ *   allocation is served from a region placed at the front of
+ *   the arena (the blank region after the cursor if it is large
+ *   enough, otherwise a new one).
+ * - Otherwise, if the region after the current one (left over
+ *   from `Arena_reset`) is large enough, the current region
+ *   is retired and the cursor moves on to it.
+ * - Otherwise, the current region is retired and a new region
+ *   is inserted directly after it, leaving any smaller blank
+ *   regions for later allocations.
+ *
+ * This way, the region with the most room left is always the
+ * current one, and allocations of a sizeable fraction of a
+ * region don't each leave a mostly empty region behind.
+ *
+ * As the cursor only moves forward, the cost of an allocation
+ * does not depend on the number of regions in the arena.
+ *
+ * If the memory being allocated fits in the next region
+ * (`COOL_ARENA_DEF_SIZE` bytes by default, see `Arena_init_ex`),
+ * then a new region will be allocated of that size.
+ *
+ * Otherwise, the allocation is large, and is given a block
+ * of its own, which is kept on a separate list instead of
+ * joining the regions of the arena. Large blocks are freed
+ * by `Arena_reset`, `Arena_rewind` and `Arena_free`, so they
+ * never bloat the regions which are kept between resets.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * char *mem = (char *) Arena_alloc(&arena, 1024);
+ *
+ * // Check for failure
+ * if (mem == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline uintptr_t *Arena_alloc(Arena *arena, uintptr_t size) {
+    char *mem = arena->_ptr;
 
-    for (;;) {
-        // Stop if there is no next value, or if
-        // this region has enough free memory
-        if (arena->_next == NULL
-            || size <= arena->_alloc_size - arena->_size) {
-            break;
-        }
+    COOL_ARENA_STAT(arena, allocs, 1);
+    COOL_ARENA_STAT(arena, requested, size);
+    COOL_ARENA_TRACE_EVENT(
+        arena, COOL_ARENA_TRACE_ALLOC, size, sizeof(uintptr_t)
+    );
 
-        // Otherwise, use the next region
-        arena = arena->_next;
-    }
+    // Round size up to a multiple of the word size
+    size = COOL_ARENA_ROUND(size);
 
-    // If this region has enough free memory, use it
-    if (size <= arena->_alloc_size - arena->_size) {
-        mem = arena->_region + arena->_size;
-        arena->_size += size;
-        return mem;
+    // A size of 0 (including one which overflowed while
+    // rounding) wraps around here, so takes the slow path
+    if (COOL_ARENA_LIKELY(
+        size - 1 < (uintptr_t) arena->_end - (uintptr_t) mem
+    )) {
+        arena->_ptr = mem + size;
+        return (uintptr_t *) mem;
     }
 
-    // Otherwise, this means this region doesn't have enough
-    // free memory, and is the end of the arena (no next region).
-    // So, a new region must be allocated.
-
-    // Calculate how much to allocate
-    new_capacity = COOL_ARENA_DEF_SIZE;
-
-    while (new_capacity < size) {
-        // Check for overflows
-        if (new_capacity > new_capacity << 1) {
-            return NULL;
-        }
+    return (uintptr_t *) _Arena_refill(arena, size, sizeof(uintptr_t));
+}
 
-        new_capacity <<= 1;
-    }
+/**
+ * Allocates a given quantity of memory within
+ * the arena, aligned to a given alignment.
+ *
+ * This behaves like `Arena_alloc`, but the memory
+ * will be aligned to `align` bytes, which is useful for
+ * SIMD buffers and structs which should sit alone on a cache line.
+ * Alignments of `sizeof(uintptr_t)` or less behave exactly
+ * like `Arena_alloc`.
+ *
+ * The size is rounded up to a multiple of `sizeof(uintptr_t)`.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * // Allocate 1024 bytes on a 64 byte boundary
+ * float *buf = Arena_alloc_aligned(&arena, 1024, 64);
+ *
+ * // Check for failure
+ * if (buf == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate.
+ * @param align The alignment, which must be a power of two.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *Arena_alloc_aligned(
+    Arena *arena, uintptr_t size, uintptr_t align
+) {
+    char *mem;
+    uintptr_t pad;
+    uintptr_t free_size;
 
-    // Try allocating a region for the arena
-    new_region = (uintptr_t *) COOL_ARENA_FUNC_ALLOC(new_capacity);
-    if (new_region == NULL) return NULL;
+    if (align <= sizeof(uintptr_t)) return Arena_alloc(arena, size);
 
-    // If the region is not blank, create a new arena
-    // and use it
-    if (arena->_region != NULL) {
-        new_arena = (Arena *) COOL_ARENA_FUNC_ALLOC(sizeof(Arena));
+    COOL_ARENA_STAT(arena, allocs, 1);
+    COOL_ARENA_STAT(arena, requested, size);
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_ALLOC, size, align);
 
-        if (new_arena == NULL) {
-            free(new_region);
-            return NULL;
-        }
+    // Round size up to a multiple of the word size
+    size = COOL_ARENA_ROUND(size);
 
-        Arena_init(new_arena);
+    // Calculate the padding needed to align the bump pointer
+    pad = -(uintptr_t) arena->_ptr & (align - 1);
+    free_size = (uintptr_t) arena->_end - (uintptr_t) arena->_ptr;
 
-        arena->_next = new_arena;
-        arena = new_arena;
+    if (COOL_ARENA_LIKELY(
+        size - 1 < free_size && pad <= free_size - size
+    )) {
+        mem = arena->_ptr + pad;
+        arena->_ptr = mem + size;
+        return mem;
     }
 
-    // Update this arena
-    arena->_region = new_region;
-    arena->_alloc_size = new_capacity;
-    arena->_size += size;
-
-    return arena->_region;
+    return _Arena_refill(arena, size, align);
+}
+
+/**
+ * Allocates a given quantity of bytes within
+ * the arena, without any alignment or padding.
+ *
+ * This is meant for densely packing data which
+ * does not need to be aligned, such as strings.
+ *
+ * Packed memory is allocated downwards from the end of
+ * the current region, while all other memory is allocated
+ * upwards from the start. This way, packed allocations never
+ * affect the alignment of other allocations, and the two can
+ * be freely mixed in the same arena.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * // Allocate exactly 14 bytes
+ * char *str = Arena_alloc_packed(&arena, 14);
+ *
+ * // Check for failure
+ * if (str == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline char *Arena_alloc_packed(Arena *arena, uintptr_t size) {
+    COOL_ARENA_STAT(arena, allocs, 1);
+    COOL_ARENA_STAT(arena, requested, size);
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_ALLOC, size, 1);
+
+    if (COOL_ARENA_LIKELY(
+        size - 1 < (uintptr_t) arena->_end - (uintptr_t) arena->_ptr
+    )) {
+        arena->_end -= size;
+        return arena->_end;
+    }
+
+    return (char *) _Arena_refill(arena, size, 1);
+}
+
+/**
+ * Allocates memory for an array of a given quantity
+ * of elements within the arena, with a given alignment.
+ *
+ * If `count * size` overflows, NULL is returned.
+ *
+ * See `Arena_new` for a more convenient way of
+ * allocating arrays of a given type.
+ *
+ * @param arena The arena to allocate memory in.
+ * @param count The quantity of elements to allocate.
+ * @param size The size of each element in bytes.
+ * @param align The alignment, which must be a power of two.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *Arena_alloc_array(
+    Arena *arena, uintptr_t count, uintptr_t size, uintptr_t align
+) {
+    // Check for overflows
+    if (size != 0 && count > UINTPTR_MAX / size) return NULL;
+
+    return Arena_alloc_aligned(arena, count * size, align);
+}
+
+/**
+ * Allocates memory for an array of a given quantity
+ * of values of a given type within the arena.
+ *
+ * The memory will be aligned to the alignment of the type,
+ * and NULL will be returned if the size of the array overflows.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * // Allocate memory for 128 ints
+ * int *nums = Arena_new(&arena, int, 128);
+ *
+ * // Check for failure
+ * if (nums == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param A A pointer to the arena to allocate memory in.
+ * @param T The type of the values.
+ * @param N The quantity of values.
+ * @return A pointer to `T` on success, NULL otherwise.
+ */
+#define Arena_new(A, T, N) \
+    ((T *) Arena_alloc_array((A), (N), sizeof(T), _Alignof(T)))
+
+/**
+ * Tries to extend (or shrink) an allocation in place.
+ *
+ * This only succeeds if the allocation is the most recent
+ * one made with `Arena_alloc`, `Arena_alloc_aligned` or
+ * `Arena_new` in the current region, and the region
+ * has enough free memory after it. In an arena initialized
+ * with `Arena_init_vm`, more of the reserved range is
+ * committed if needed, unless packed memory is in the way.
+ *
+ * See `Arena_realloc` for a version which falls back
+ * to copying the allocation.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * char *buf = (char *) Arena_alloc(&arena, 64);
+ *
+ * // Try to grow the buffer to 128 bytes
+ * if (!Arena_extend(&arena, buf, 64, 128)) {
+ *     // The buffer could not be grown in place
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena the allocation is in.
+ * @param ptr The allocation.
+ * @param old_size The size the allocation was made with.
+ * @param new_size The size to resize the allocation to.
+ * @return 1 if the allocation was resized, 0 otherwise.
+ */
+static inline int Arena_extend(
+    Arena *arena, void *ptr, uintptr_t old_size, uintptr_t new_size
+) {
+    uintptr_t size;
+
+    // Check that this is the most recent allocation
+    if (ptr == NULL
+        || (char *) ptr + COOL_ARENA_ROUND(old_size) != arena->_ptr) {
+        return 0;
+    }
+
+    // Check for overflows, and that the region has room
+    size = COOL_ARENA_ROUND(new_size);
+
+    if (size < new_size) return 0;
+
+    if (size > (uintptr_t) (arena->_end - (char *) ptr)) {
+        return arena->_vm_base != NULL
+            && _Arena_extend_vm(arena, (char *) ptr, size);
+    }
+
+    arena->_ptr = (char *) ptr + size;
+    return 1;
+}
+
+/**
+ * Pops the most recent allocation off of the arena,
+ * so that its memory can be used again.
+ *
+ * This only succeeds if the allocation is the most recent
+ * one made with `Arena_alloc`, `Arena_alloc_aligned` or
+ * `Arena_new` in the current region.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * char *tmp = (char *) Arena_alloc(&arena, 64);
+ *
+ * // ----
+ *
+ * Arena_pop(&arena, tmp, 64);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena the allocation is in.
+ * @param ptr The allocation.
+ * @param size The size the allocation was made with.
+ * @return 1 if the allocation was popped, 0 otherwise.
+ */
+static inline int Arena_pop(Arena *arena, void *ptr, uintptr_t size) {
+    if (ptr == NULL
+        || (char *) ptr + COOL_ARENA_ROUND(size) != arena->_ptr) {
+        return 0;
+    }
+
+    arena->_ptr = (char *) ptr;
+    return 1;
+}
+
+/**
+ * Resizes an allocation within the arena.
+ *
+ * If the allocation is the most recent one in the current
+ * region (see `Arena_extend`) and there is enough free memory
+ * after it, then it is resized in place. Any other allocation
+ * being shrunk is left where it is, and its pointer returned.
+ * Otherwise, a new allocation is made and the contents are
+ * copied over. If the old allocation was the most recent one,
+ * its memory is released in this case.
+ *
+ * The new allocation (if any) is aligned like `Arena_alloc`.
+ *
+ * If `ptr` is NULL, this behaves like `Arena_alloc`.
+ * If `new_size` is 0, the allocation is popped if possible
+ * (see `Arena_pop`), and NULL is returned.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * char *buf = (char *) Arena_alloc(&arena, 64);
+ * char *tmp = (char *) Arena_realloc(&arena, buf, 64, 128);
+ *
+ * // Check for failure
+ * if (tmp == NULL) {
+ *     perror("malloc");
+ * } else {
+ *     buf = tmp;
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena the allocation is in.
+ * @param ptr The allocation.
+ * @param old_size The size the allocation was made with.
+ * @param new_size The size to resize the allocation to.
+ * @return A pointer on success, NULL otherwise.
+ */
+void *Arena_realloc(
+    Arena *arena, void *ptr, uintptr_t old_size, uintptr_t new_size
+);
+
+static inline void *_Arena_allocator_alloc(void *ctx, size_t size) {
+    return Arena_alloc((Arena *) ctx, size);
+}
+
+static inline void *_Arena_allocator_realloc(
+    void *ctx, void *ptr, size_t old_size, size_t new_size
+) {
+    return Arena_realloc((Arena *) ctx, ptr, old_size, new_size);
+}
+
+static inline void _Arena_allocator_free(void *ctx, void *ptr, size_t size) {
+    Arena_pop((Arena *) ctx, ptr, size);
+}
+
+/**
+ * Gets an allocator (see `Allocator`) which allocates
+ * within the arena, so that containers such as lists
+ * can keep their memory in it.
+ *
+ * Allocations are made with `Arena_alloc` and resized with
+ * `Arena_realloc`, so the most recent allocation grows in place.
+ * Freeing only releases memory if the allocation is the most
+ * recent one (see `Arena_pop`), and otherwise does nothing until
+ * the arena is reset.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * const Allocator *allocator = Arena_allocator(&arena);
+ * char *mem = (char *) Allocator_alloc(allocator, 64);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate within.
+ * @return The allocator, which is stored within the
+ *         arena, so is valid for as long as the arena is.
+ */
+static inline const Allocator *Arena_allocator(Arena *arena) {
+    arena->_self.alloc = _Arena_allocator_alloc;
+    arena->_self.realloc = _Arena_allocator_realloc;
+    arena->_self.free = _Arena_allocator_free;
+    arena->_self.ctx = arena;
+
+    return &arena->_self;
+}
+
+/**
+ * Marks the current position of the arena, so that
+ * it can later be restored with `Arena_rewind`.
+ *
+ * This is cheap, only copying a few pointers
+ * and numbering the mark.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * ArenaMark mark = Arena_mark(&arena);
+ *
+ * // Allocate temporary memory
+ *
+ * Arena_rewind(&arena, mark);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to mark.
+ * @return The mark.
+ */
+static inline ArenaMark Arena_mark(Arena *arena) {
+    ArenaMark mark;
+
+    mark._ptr = arena->_ptr;
+    mark._end = arena->_end;
+    mark._head = arena->_head;
+    mark._current = arena->_current;
+    mark._large = arena->_large;
+    mark._vm_packed = arena->_vm_packed;
+    mark._id = ++arena->_marks;
+
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_MARK, mark._id, 0);
+
+    return mark;
+}
+
+/**
+ * Rewinds the arena to a mark made with `Arena_mark`,
+ * releasing all memory allocated since the mark was made.
+ *
+ * Regions which were filled since the mark are reset,
+ * so that they can be used by later allocations, and the
+ * cursor is moved back to where it was. Large allocations
+ * made since the mark are freed. This takes time
+ * proportional to the number of regions released.
+ *
+ * Marks can be nested, as long as they are rewound in
+ * reverse order. A mark is invalidated by rewinding to an
+ * earlier mark, and by `Arena_reset` and `Arena_free`.
+ *
+ * This does not reset the memory in the regions.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * ArenaMark outer = Arena_mark(&arena);
+ * ArenaMark inner;
+ *
+ * // Allocate temporary memory
+ *
+ * inner = Arena_mark(&arena);
+ *
+ * // Allocate more temporary memory
+ *
+ * Arena_rewind(&arena, inner);
+ * Arena_rewind(&arena, outer);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to rewind.
+ * @param mark The mark to rewind to.
+ */
+void Arena_rewind(Arena *arena, ArenaMark mark);
+
+/**
+ * Resets the arena.
+ *
+ * All currently allocated regions will remain, but
+ * they will be reset, so that memory can be allocated within
+ * them once more. The cursor is moved back to the first region.
+ *
+ * For an arena initialized with `Arena_init_vm`, the bump
+ * pointer is moved back to the start of the reserved range,
+ * and all committed memory remains committed.
+ *
+ * This does not reset the memory in the regions.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_reset(&arena);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to reset.
+ */
+void Arena_reset(Arena *arena);
+
+/**
+ * A flag for `Arena_reset_ex`, freeing regions
+ * beyond the retention budget of the arena.
+ */
+#define COOL_ARENA_RESET_TRIM 1
+
+/**
+ * A flag for `Arena_reset_ex`, replacing all the
+ * regions of the arena with a single region sized
+ * to the retention budget of the arena.
+ */
+#define COOL_ARENA_RESET_CONSOLIDATE 2
+
+/**
+ * Resets the arena like `Arena_reset`, optionally
+ * trimming the memory it holds on to.
+ *
+ * Each reset (including `Arena_reset`) records how much
+ * memory was used since the last one, and updates the
+ * high-water mark of the arena (see `Arena_peak`).
+ * The high-water mark decays a little on every reset,
+ * so that a single spike in usage is forgotten over time.
+ *
+ * The retention budget of the arena is set with
+ * `Arena_set_retain`, and is the high-water mark by default.
+ *
+ * If `COOL_ARENA_RESET_TRIM` is passed, regions are kept
+ * in order until their sizes add up to the retention budget,
+ * and the rest are freed.
+ *
+ * If `COOL_ARENA_RESET_CONSOLIDATE` is passed, and the arena
+ * has more than one region (or a region smaller than the
+ * budget, or more than twice as large), all regions are freed
+ * and replaced with a single region the size of the retention budget. This way, an arena
+ * which is reset in a loop settles on a single region.
+ * If this region can't be allocated, the arena is left blank.
+ *
+ * For an arena initialized with `Arena_init_vm`, either flag
+ * decommits the memory beyond the retention budget.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_reset_ex(&arena, COOL_ARENA_RESET_CONSOLIDATE);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to reset.
+ * @param flags 0, or any of `COOL_ARENA_RESET_TRIM` and
+ *              `COOL_ARENA_RESET_CONSOLIDATE`.
+ */
+void Arena_reset_ex(Arena *arena, int flags);
+
+/**
+ * Sets the retention budget of the arena, used by
+ * `Arena_reset_ex` when trimming.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * // Keep at most 1 MiB of regions when trimming
+ * Arena_set_retain(&arena, 1024 * 1024);
+ * Arena_reset_ex(&arena, COOL_ARENA_RESET_TRIM);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to set the budget for.
+ * @param size The budget in bytes, or 0 to use
+ *             the high-water mark of the arena.
+ */
+void Arena_set_retain(Arena *arena, uintptr_t size);
+
+/**
+ * Sets the allocator (see `Allocator`) the arena allocates its
+ * regions and large blocks with, instead of `COOL_ARENA_FUNC_ALLOC`
+ * and `COOL_ARENA_FUNC_FREE`. This can be another arena, so that
+ * the regions of the arena live within it.
+ *
+ * This must be called before the arena allocates any memory.
+ * Regions from an allocator are never cached with
+ * `COOL_ARENA_CACHE`, and arenas initialized with
+ * `Arena_init_vm` don't use the allocator.
+ *
+ * For example:
+ * ```
+ * Allocator allocator;
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_init(&arena);
+ * Arena_set_allocator(&arena, &allocator);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to set the allocator of.
+ * @param allocator The allocator, which must outlive the
+ *                  arena, or NULL to use `COOL_ARENA_FUNC_ALLOC`.
+ */
+void Arena_set_allocator(Arena *arena, const Allocator *allocator);
+
+/**
+ * Gets the (decaying) high-water mark of the arena, which is
+ * the most memory used between two resets of the arena.
+ *
+ * This includes padding used for alignment.
+ *
+ * @param arena The arena to get the high-water mark of.
+ * @return The high-water mark in bytes.
+ */
+uintptr_t Arena_peak(Arena *arena);
+
+/**
+ * Frees the arena.
+ *
+ * Each region will individually be freed and
+ * the arena will be reinitialized, keeping the
+ * region sizes it was initialized with.
+ *
+ * For an arena initialized with `Arena_init_vm`,
+ * the reserved range is unmapped.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_free(&arena);
+ *
+ * ```
+ */
+void Arena_free(Arena *arena);
+
+/**
+ * Dumps each region of the arena to stdout.
+ *
+ * Quite useful for debugging.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_dump(&arena);
+ *
+ * // ----
+ *
+ * ```
+ */
+void Arena_dump(Arena *arena);
+
+#ifdef COOL_STATS
+
+/**
+ * Gets the statistics of an arena.
+ *
+ * Counting is compiled in only if `COOL_STATS` is defined,
+ * and costs nothing otherwise. The counters are kept until
+ * the arena is initialized again, including across `Arena_free`.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * ArenaStats stats = Arena_stats(&arena);
+ * printf("%lu allocations\n", stats.allocs);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to get the statistics of.
+ * @return The statistics.
+ */
+ArenaStats Arena_stats(Arena *arena);
+
+/**
+ * Writes the statistics of an arena (see `Arena_stats`)
+ * to a stream, as a single line JSON object.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ *
+ * // ----
+ *
+ * Arena_stats_json(&arena, stderr);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to write the statistics of.
+ * @param stream The stream to write to.
+ */
+void Arena_stats_json(Arena *arena, FILE *stream);
+
+#endif // COOL_STATS
+
+#ifdef COOL_ARENA_IMPL
+
+/**
+ * The default quantity of bytes to allocate
+ * to each region in the arena.
+ *
+ * Each region starts with a small header
+ * (see `COOL_ARENA_HEADER_SIZE`), which is
+ * included in this size.
+ */
+#ifndef COOL_ARENA_DEF_SIZE
+#define COOL_ARENA_DEF_SIZE 8 * 1024
+#endif
+
+/**
+ * The default factor to grow the size of each
+ * new region in the arena by.
+ */
+#ifndef COOL_ARENA_GROWTH
+#define COOL_ARENA_GROWTH 1
+#endif
+
+/**
+ * The default maximum quantity of bytes to allocate to
+ * a region in the arena when growing region sizes.
+ */
+#ifndef COOL_ARENA_MAX_SIZE
+#define COOL_ARENA_MAX_SIZE 64 * 1024 * 1024
+#endif
+
+/**
+ * How quickly the high-water mark of the arena decays.
+ *
+ * On every reset, the high-water mark is lowered by
+ * 1 / 2^`COOL_ARENA_PEAK_DECAY` of itself, unless the
+ * memory used since the last reset was higher.
+ */
+#ifndef COOL_ARENA_PEAK_DECAY
+#define COOL_ARENA_PEAK_DECAY 3
+#endif
+
+/**
+ * The fraction of the region size of an arena at which
+ * the current region is considered nearly full.
+ *
+ * When an allocation does not fit in the current region,
+ * the region is only retired if it has fewer free bytes
+ * than 1 / `COOL_ARENA_RETIRE_RATIO` of the region size
+ * the arena was initialized with. Otherwise it stays current,
+ * so that smaller allocations can continue to fill it.
+ */
+#ifndef COOL_ARENA_RETIRE_RATIO
+#define COOL_ARENA_RETIRE_RATIO 8
+#endif
+
+/**
+ * The underlying function for allocating
+ * memory for Arena structs and regions.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `malloc(3)`.
+ *
+ * This function must also return a valid pointer
+ * on success, and NULL on failure.
+ */
+#ifndef COOL_ARENA_FUNC_ALLOC
+#include <stdlib.h>
+#define COOL_ARENA_FUNC_ALLOC malloc
+#endif
+
+/**
+ * The underlying function for freeing
+ * memory for a region.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `free(3)`
+ */
+#ifndef COOL_ARENA_FUNC_FREE
+#include <stdlib.h>
+#define COOL_ARENA_FUNC_FREE free
+#endif
+
+/**
+ * The quantity of bytes at the start of each region
+ * taken up by its `ArenaRegion` header.
+ *
+ * This keeps the memory after the header aligned as
+ * strictly as the underlying allocator does.
+ */
+#define COOL_ARENA_HEADER_SIZE                         \
+    ((sizeof(ArenaRegion) + _Alignof(max_align_t) - 1) \
+        & ~(_Alignof(max_align_t) - 1))
+
+// Regions include their header, so they must be larger than it
+_Static_assert(
+    (COOL_ARENA_DEF_SIZE) > COOL_ARENA_HEADER_SIZE,
+    "COOL_ARENA_DEF_SIZE must be larger than COOL_ARENA_HEADER_SIZE"
+);
+
+#ifdef COOL_ARENA_VM
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * The quantity of bytes to commit at a time in an
+ * arena initialized with `Arena_init_vm`.
+ *
+ * This is rounded up to a multiple of the page size.
+ */
+#ifndef COOL_ARENA_VM_COMMIT_SIZE
+#define COOL_ARENA_VM_COMMIT_SIZE 64 * 1024
+#endif
+
+/**
+ * The size of a huge page, used for arenas initialized
+ * with `Arena_init_vm` and `COOL_ARENA_VM_HUGE`.
+ */
+#ifndef COOL_ARENA_VM_HUGE_SIZE
+#define COOL_ARENA_VM_HUGE_SIZE 2 * 1024 * 1024
+#endif
+
+#endif // COOL_ARENA_VM
+
+#ifdef COOL_ARENA_CACHE
+
+#include <pthread.h>
+
+/**
+ * The maximum quantity of regions of each size
+ * class to cache in each thread.
+ */
+#ifndef COOL_ARENA_CACHE_LOCAL_MAX
+#define COOL_ARENA_CACHE_LOCAL_MAX 4
+#endif
+
+/**
+ * The maximum quantity of bytes of regions
+ * to cache in the global pool.
+ */
+#ifndef COOL_ARENA_CACHE_MAX
+#define COOL_ARENA_CACHE_MAX 64 * 1024 * 1024
+#endif
+
+/**
+ * The largest region (including its header) to cache.
+ *
+ * Regions up to this size are rounded up to a power of two,
+ * which is the size class they are cached by. Larger regions
+ * are always freed.
+ */
+#ifndef COOL_ARENA_CACHE_REGION_MAX
+#define COOL_ARENA_CACHE_REGION_MAX COOL_ARENA_MAX_SIZE
+#endif
+
+#define _COOL_ARENA_CACHE_CLASSES (sizeof(uintptr_t) * 8)
+
+static _Thread_local ArenaRegion *_arena_cache_local[_COOL_ARENA_CACHE_CLASSES];
+static _Thread_local uintptr_t _arena_cache_local_count[_COOL_ARENA_CACHE_CLASSES];
+static _Thread_local int _arena_cache_registered;
+
+static ArenaRegion *_arena_cache_global[_COOL_ARENA_CACHE_CLASSES];
+static uintptr_t _arena_cache_global_size;
+static pthread_mutex_t _arena_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_once_t _arena_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _arena_cache_key;
+static int _arena_cache_key_ok;
+
+#endif // COOL_ARENA_CACHE
+
+#ifdef COOL_ARENA_TRACE
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+/**
+ * Calculates how many bytes of the current region
+ * of the arena are in use, from both ends.
+ */
+static uintptr_t _Arena_current_size(Arena *arena) {
+    ArenaRegion *region = arena->_current;
+
+    return region->_alloc_size
+        - (uintptr_t) (arena->_end - arena->_ptr);
+}
+
+/**
+ * Moves the cursor of the arena to a given blank region,
+ * recording how much of the current region was used.
+ */
+static void _Arena_set_current(Arena *arena, ArenaRegion *region) {
+    if (arena->_current != NULL) {
+        arena->_current->_size = _Arena_current_size(arena);
+        COOL_ARENA_STAT(
+            arena, wasted, (uintptr_t) (arena->_end - arena->_ptr)
+        );
+    }
+
+    arena->_current = region;
+
+    if (region == NULL) {
+        arena->_ptr = NULL;
+        arena->_end = NULL;
+    } else {
+        arena->_ptr = (char *) region->_region;
+        arena->_end = (char *) region->_region + region->_alloc_size;
+    }
+}
+
+/**
+ * Carves an allocation out of the free memory between
+ * `*ptr` and `*end`, moving whichever bound is used.
+ *
+ * Returns NULL if the allocation does not fit.
+ */
+static char *_Arena_carve(
+    char **ptr, char **end, uintptr_t size, uintptr_t align
+) {
+    uintptr_t free_size = (uintptr_t) (*end - *ptr);
+    uintptr_t pad;
+    char *mem;
+
+    if (size > free_size) return NULL;
+
+    // Packed memory comes from the top
+    if (align == 1) {
+        *end -= size;
+        return *end;
+    }
+
+    pad = -(uintptr_t) *ptr & (align - 1);
+    if (pad > free_size - size) return NULL;
+
+    mem = *ptr + pad;
+    *ptr = mem + size;
+    return mem;
+}
+
+/**
+ * Carves an allocation out of a blank region
+ * which is not the current region.
+ */
+static char *_Arena_carve_region(
+    ArenaRegion *region, uintptr_t size, uintptr_t align
+) {
+    char *ptr = (char *) region->_region;
+    char *end = ptr + region->_alloc_size;
+    char *mem = _Arena_carve(&ptr, &end, size, align);
+
+    region->_size = region->_alloc_size - (uintptr_t) (end - ptr);
+    return mem;
+}
+
+/**
+ * Clears all the memory of an arena,
+ * without changing its region sizes.
+ */
+static void _Arena_clear(Arena *arena) {
+    arena->_ptr = NULL;
+    arena->_end = NULL;
+    arena->_head = NULL;
+    arena->_current = NULL;
+    arena->_buffer = NULL;
+    arena->_large = NULL;
+    arena->_vm_base = NULL;
+    arena->_vm_commit = NULL;
+    arena->_vm_limit = NULL;
+    arena->_vm_packed = NULL;
+    arena->_vm_granule = 0;
+    arena->_next_size = arena->_def_size;
+    arena->_peak = 0;
+    arena->_spare = NULL;
+}
+
+#ifdef COOL_ARENA_CACHE
+
+/**
+ * Finds the size class of a block,
+ * or -1 if the block can't be cached.
+ */
+static int _Arena_cache_class(uintptr_t size) {
+    int class = 0;
+
+    if (size == 0 || (size & (size - 1)) != 0
+        || size > COOL_ARENA_CACHE_REGION_MAX) {
+        return -1;
+    }
+
+    while ((uintptr_t) 1 << class != size) class++;
+
+    return class;
+}
+
+/**
+ * Moves every region cached by the calling
+ * thread to the global pool, freeing those
+ * which don't fit.
+ */
+static void _Arena_cache_flush(void) {
+    ArenaRegion *excess = NULL;
+    ArenaRegion *region;
+    ArenaRegion *next;
+    uintptr_t size;
+
+    pthread_mutex_lock(&_arena_cache_lock);
+
+    for (uintptr_t class = 0; class < _COOL_ARENA_CACHE_CLASSES; class++) {
+        size = (uintptr_t) 1 << class;
+        region = _arena_cache_local[class];
+
+        _arena_cache_local[class] = NULL;
+        _arena_cache_local_count[class] = 0;
+
+        for (; region != NULL; region = next) {
+            next = region->_next;
+
+            if (_arena_cache_global_size + size <= COOL_ARENA_CACHE_MAX) {
+                region->_next = _arena_cache_global[class];
+                _arena_cache_global[class] = region;
+                _arena_cache_global_size += size;
+            } else {
+                region->_next = excess;
+                excess = region;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_arena_cache_lock);
+
+    for (; excess != NULL; excess = next) {
+        next = excess->_next;
+        COOL_ARENA_FUNC_FREE(excess);
+    }
+}
+
+/**
+ * Flushes the cache of a thread as it exits.
+ */
+static void _Arena_cache_exit(void *value) {
+    (void) value;
+    _Arena_cache_flush();
+}
+
+static void _Arena_cache_key_init(void) {
+    _arena_cache_key_ok = pthread_key_create(
+        &_arena_cache_key, _Arena_cache_exit
+    ) == 0;
+}
+
+/**
+ * Takes a block of a given size class from the
+ * cache, or returns NULL if none are cached.
+ */
+static ArenaRegion *_Arena_cache_get(int class) {
+    ArenaRegion *region = _arena_cache_local[class];
+
+    if (region != NULL) {
+        _arena_cache_local[class] = region->_next;
+        _arena_cache_local_count[class]--;
+        return region;
+    }
+
+    pthread_mutex_lock(&_arena_cache_lock);
+
+    region = _arena_cache_global[class];
+
+    if (region != NULL) {
+        _arena_cache_global[class] = region->_next;
+        _arena_cache_global_size -= (uintptr_t) 1 << class;
+    }
+
+    pthread_mutex_unlock(&_arena_cache_lock);
+
+    return region;
+}
+
+/**
+ * Puts a block of a given size class into the
+ * cache, or frees it if the cache is full.
+ */
+static void _Arena_cache_put(ArenaRegion *region, int class) {
+    uintptr_t size = (uintptr_t) 1 << class;
+
+    // Make sure the thread's cache is flushed when it exits,
+    // otherwise only the global pool can be used
+    if (_arena_cache_registered == 0) {
+        pthread_once(&_arena_cache_once, _Arena_cache_key_init);
+
+        _arena_cache_registered = (_arena_cache_key_ok
+            && pthread_setspecific(_arena_cache_key, &_arena_cache_key) == 0)
+            ? 1 : -1;
+    }
+
+    if (_arena_cache_registered == 1
+        && _arena_cache_local_count[class] < COOL_ARENA_CACHE_LOCAL_MAX) {
+        region->_next = _arena_cache_local[class];
+        _arena_cache_local[class] = region;
+        _arena_cache_local_count[class]++;
+        return;
+    }
+
+    pthread_mutex_lock(&_arena_cache_lock);
+
+    if (_arena_cache_global_size + size <= COOL_ARENA_CACHE_MAX) {
+        region->_next = _arena_cache_global[class];
+        _arena_cache_global[class] = region;
+        _arena_cache_global_size += size;
+        region = NULL;
+    }
+
+    pthread_mutex_unlock(&_arena_cache_lock);
+
+    if (region != NULL) COOL_ARENA_FUNC_FREE(region);
+}
+
+void Arena_cache_trim(uintptr_t size) {
+    ArenaRegion *excess = NULL;
+    ArenaRegion *region;
+    ArenaRegion *next;
+    uintptr_t class = _COOL_ARENA_CACHE_CLASSES;
+
+    _Arena_cache_flush();
+
+    pthread_mutex_lock(&_arena_cache_lock);
+
+    // Free the largest regions first
+    while (_arena_cache_global_size > size && class > 0) {
+        class--;
+
+        while (_arena_cache_global_size > size
+            && _arena_cache_global[class] != NULL) {
+            region = _arena_cache_global[class];
+            _arena_cache_global[class] = region->_next;
+            _arena_cache_global_size -= (uintptr_t) 1 << class;
+
+            region->_next = excess;
+            excess = region;
+        }
+    }
+
+    pthread_mutex_unlock(&_arena_cache_lock);
+
+    for (; excess != NULL; excess = next) {
+        next = excess->_next;
+        COOL_ARENA_FUNC_FREE(excess);
+    }
+}
+
+#endif // COOL_ARENA_CACHE
+
+/**
+ * Allocates a block with the allocator of the
+ * arena, or `COOL_ARENA_FUNC_ALLOC` if it has none.
+ *
+ * A child arena may be handed a larger block than it asked
+ * for (see `_Arena_child_alloc`), in which case the size
+ * is updated to the real size of the block.
+ */
+static void *_Arena_block_alloc(Arena *arena, uintptr_t *size) {
+    ArenaRegion *block;
+
+    if (arena->_allocator == &arena->_borrow) {
+        block = (ArenaRegion *) Allocator_alloc(arena->_allocator, *size);
+        if (block != NULL) *size = block->_alloc_size + COOL_ARENA_HEADER_SIZE;
+
+        return block;
+    }
+
+    if (arena->_allocator != NULL) {
+        return Allocator_alloc(arena->_allocator, *size);
+    }
+
+    return COOL_ARENA_FUNC_ALLOC(*size);
+}
+
+/**
+ * Frees a block of a given size allocated by `_Arena_block_alloc`.
+ */
+static void _Arena_block_free(Arena *arena, void *block, uintptr_t size) {
+    if (arena->_allocator != NULL) {
+        Allocator_free(arena->_allocator, block, size);
+        return;
+    }
+
+    COOL_ARENA_FUNC_FREE(block);
+}
+
+/**
+ * Allocates a blank region for an arena, made up of a block of
+ * a given size, with the `ArenaRegion` header at the start of
+ * the block, followed by the memory of the region.
+ *
+ * With `COOL_ARENA_CACHE`, the size is rounded up to a
+ * size class, and the block is taken from the cache if
+ * possible (unless the arena has an allocator).
+ *
+ * The size must be larger than `COOL_ARENA_HEADER_SIZE`.
+ */
+static ArenaRegion *_Arena_region_new(Arena *arena, uintptr_t size) {
+    ArenaRegion *region = NULL;
+
+#ifdef COOL_ARENA_CACHE
+    uintptr_t block = 1;
+    int class;
+
+    while (block < size && block <= COOL_ARENA_CACHE_REGION_MAX) block <<= 1;
+
+    class = (arena->_allocator == NULL) ? _Arena_cache_class(block) : -1;
+
+    if (class >= 0) {
+        size = block;
+        region = _Arena_cache_get(class);
+    }
+#endif
+
+    if (region == NULL) {
+        region = (ArenaRegion *) _Arena_block_alloc(arena, &size);
+        if (region == NULL) return NULL;
+    }
+
+    region->_region = (uintptr_t *) ((char *) region + COOL_ARENA_HEADER_SIZE);
+    region->_size = 0;
+    region->_alloc_size = size - COOL_ARENA_HEADER_SIZE;
+    region->_next = NULL;
+
+    return region;
+}
+
+/**
+ * Frees a region and its memory, unless the
+ * region is the buffer supplied by the caller.
+ *
+ * With `COOL_ARENA_CACHE`, the block is cached if possible.
+ */
+static void _Arena_region_free(Arena *arena, ArenaRegion *region) {
+#ifdef COOL_ARENA_CACHE
+    int class;
+#endif
+
+    if (region == arena->_buffer) return;
+
+#ifdef COOL_ARENA_CACHE
+    class = (arena->_allocator == NULL)
+        ? _Arena_cache_class(region->_alloc_size + COOL_ARENA_HEADER_SIZE)
+        : -1;
+
+    if (class >= 0) {
+        _Arena_cache_put(region, class);
+        return;
+    }
+#endif
+
+    _Arena_block_free(
+        arena, region, region->_alloc_size + COOL_ARENA_HEADER_SIZE
+    );
+}
+
+/**
+ * Calculates how many bytes of the regions
+ * of the arena are in use, from both ends.
+ */
+static uintptr_t _Arena_used(Arena *arena) {
+    ArenaRegion *region = arena->_head;
+    uintptr_t used;
+
+    if (arena->_vm_base != NULL) {
+        return (uintptr_t) (arena->_ptr - arena->_vm_base)
+            + (uintptr_t) (arena->_vm_packed - arena->_end);
+    }
+
+    if (arena->_current == NULL) return 0;
+
+    used = _Arena_current_size(arena);
+
+    for (; region != arena->_current; region = region->_next) {
+        used += region->_size;
+    }
+
+    return used;
+}
+
+/**
+ * Allocates a block of its own for a large allocation,
+ * and places it on the list of large blocks of the arena.
+ *
+ * The block size includes `COOL_ARENA_HEADER_SIZE`,
+ * and enough padding to align the allocation.
+ */
+static void *_Arena_alloc_large(
+    Arena *arena, uintptr_t size, uintptr_t align, uintptr_t block_size
+) {
+    ArenaRegion *block;
+    char *ptr;
+    char *end;
+
+    // Large blocks are never cached, so bypass `_Arena_region_new`
+    COOL_TRACE_BEGIN("Arena large");
+    block = (ArenaRegion *) _Arena_block_alloc(arena, &block_size);
+    COOL_TRACE_END("Arena large");
+
+    if (block == NULL) return NULL;
+
+    block->_region = (uintptr_t *) ((char *) block + COOL_ARENA_HEADER_SIZE);
+    block->_alloc_size = block_size - COOL_ARENA_HEADER_SIZE;
+    block->_size = block->_alloc_size;
+    block->_next = arena->_large;
+    arena->_large = block;
+
+    COOL_ARENA_STAT(arena, large_allocs, 1);
+    COOL_ARENA_STAT(arena, reserved, block_size);
+
+    ptr = (char *) block->_region;
+    end = ptr + block->_alloc_size;
+
+    return _Arena_carve(&ptr, &end, size, align);
+}
+
+/**
+ * Frees the large blocks of the arena which were
+ * allocated after a given one, or all of them if NULL.
+ */
+static void _Arena_free_large(Arena *arena, ArenaRegion *until) {
+    ArenaRegion *block = arena->_large;
+    ArenaRegion *next;
+
+    while (block != until) {
+        next = block->_next;
+        _Arena_block_free(
+            arena, block, block->_alloc_size + COOL_ARENA_HEADER_SIZE
+        );
+        block = next;
+    }
+
+    arena->_large = until;
+}
+
+/**
+ * Resets every region of the arena, and moves
+ * the cursor back to the first one.
+ */
+static void _Arena_blank(Arena *arena) {
+    ArenaRegion *region = arena->_head;
+
+    // Iterate over all regions and reset size
+    while (region != NULL) {
+        region->_size = 0;
+        region = region->_next;
+    }
+
+    // Move the cursor back to the start
+    arena->_current = NULL;
+    _Arena_set_current(arena, arena->_head);
+}
+
+void Arena_init(Arena *arena) {
+    Arena_init_ex(
+        arena, COOL_ARENA_DEF_SIZE, COOL_ARENA_GROWTH, COOL_ARENA_MAX_SIZE
+    );
+}
+
+/**
+ * Allocates a block for a child arena from its parent,
+ * reusing the smallest block returned by an earlier
+ * child which is large enough, if there is one.
+ *
+ * Blocks of child arenas start with an `ArenaRegion` header,
+ * whose `_alloc_size` is the size of the block less the
+ * header. A reused block may be larger than requested, so the
+ * child reads its real size from there, and keeps it until the
+ * block is returned, so that none of the block is lost.
+ */
+static void *_Arena_child_alloc(void *ctx, size_t size) {
+    Arena *parent = (Arena *) ctx;
+    ArenaRegion **link = &parent->_spare;
+    ArenaRegion **best = NULL;
+    ArenaRegion *block;
+
+    for (; *link != NULL; link = &(*link)->_next) {
+        if ((*link)->_alloc_size + COOL_ARENA_HEADER_SIZE < size) continue;
+
+        if (best == NULL || (*link)->_alloc_size < (*best)->_alloc_size) {
+            best = link;
+            if ((*best)->_alloc_size + COOL_ARENA_HEADER_SIZE == size) break;
+        }
+    }
+
+    if (best != NULL) {
+        block = *best;
+        *best = block->_next;
+        return block;
+    }
+
+    // Keep the header of the region aligned
+    block = (ArenaRegion *) Arena_alloc_aligned(
+        parent, size, _Alignof(max_align_t)
+    );
+    if (block != NULL) block->_alloc_size = size - COOL_ARENA_HEADER_SIZE;
+
+    return block;
+}
+
+/**
+ * Returns a block of a child arena to its parent, so that it
+ * can be handed out again. The header of the block still holds
+ * its real size, which may be larger than the size given.
+ */
+static void _Arena_child_free(void *ctx, void *ptr, size_t size) {
+    Arena *parent = (Arena *) ctx;
+    ArenaRegion *block = (ArenaRegion *) ptr;
+
+    (void) size;
+    if (block == NULL) return;
+
+    block->_next = parent->_spare;
+    parent->_spare = block;
+}
+
+static void *_Arena_child_realloc(
+    void *ctx, void *ptr, size_t old_size, size_t new_size
+) {
+    ArenaRegion *mem = (ArenaRegion *) _Arena_child_alloc(ctx, new_size);
+    uintptr_t alloc_size;
+
+    if (mem != NULL && ptr != NULL) {
+        // Keep the real size of the new block
+        alloc_size = mem->_alloc_size;
+        memcpy(mem, ptr, (old_size < new_size) ? old_size : new_size);
+        mem->_alloc_size = alloc_size;
+
+        _Arena_child_free(ctx, ptr, old_size);
+    }
+
+    return mem;
+}
+
+void Arena_init_buffer(Arena *arena, void *buf, uintptr_t size) {
+    uintptr_t pad = -(uintptr_t) buf & (_Alignof(max_align_t) - 1);
+    ArenaRegion *region;
+
+    Arena_init(arena);
+
+    // Align the header, and check there's room for it
+    if (buf == NULL || pad > size
+        || size - pad <= COOL_ARENA_HEADER_SIZE + sizeof(uintptr_t)) {
+        return;
+    }
+
+    region = (ArenaRegion *) ((char *) buf + pad);
+    region->_region = (uintptr_t *) ((char *) region + COOL_ARENA_HEADER_SIZE);
+    region->_size = 0;
+    region->_alloc_size = (size - pad - COOL_ARENA_HEADER_SIZE)
+        & ~(uintptr_t) (sizeof(uintptr_t) - 1);
+    region->_next = NULL;
+
+    arena->_head = region;
+    arena->_buffer = region;
+    _Arena_set_current(arena, region);
+
+    // Retire regions against the buffer if it's the smaller one
+    if (region->_alloc_size < arena->_def_size) {
+        arena->_retire = region->_alloc_size / COOL_ARENA_RETIRE_RATIO;
+    }
+}
+
+void Arena_init_ex(
+    Arena *arena, uintptr_t size, uintptr_t growth, uintptr_t max_size
+) {
+    if (size == 0) size = COOL_ARENA_DEF_SIZE;
+    if (growth == 0) growth = 1;
+
+    // Keep the end of each region aligned
+    arena->_def_size = COOL_ARENA_ROUND(size);
+    if (arena->_def_size == 0) arena->_def_size = size;
+
+    max_size &= ~(uintptr_t) (sizeof(uintptr_t) - 1);
+    if (max_size < arena->_def_size) max_size = arena->_def_size;
+
+    arena->_growth = growth;
+    arena->_max_size = max_size;
+    arena->_retire = arena->_def_size / COOL_ARENA_RETIRE_RATIO;
+    arena->_retain = 0;
+    arena->_marks = 0;
+    arena->_allocator = NULL;
+    arena->_spare = NULL;
+
+#ifdef COOL_STATS
+    memset(&arena->_stats, 0, sizeof(arena->_stats));
+#endif
+
+    _Arena_clear(arena);
+
+    COOL_ARENA_TRACE_EVENT(
+        arena, COOL_ARENA_TRACE_INIT, arena->_def_size, 0
+    );
+}
+
+#ifdef COOL_ARENA_VM
+
+int Arena_init_vm(Arena *arena, uintptr_t reserve, int flags) {
+    uintptr_t granule = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t head;
+    char *base = MAP_FAILED;
+
+    Arena_init(arena);
+
+    // Round the commit size up to a multiple of the page size
+    if (flags & COOL_ARENA_VM_HUGE) {
+        granule = COOL_ARENA_VM_HUGE_SIZE;
+    } else {
+        granule = ((COOL_ARENA_VM_COMMIT_SIZE) + granule - 1) & ~(granule - 1);
+    }
+
+    // Round the reservation up to a multiple of the commit size
+    if (reserve == 0 || reserve > UINTPTR_MAX - 2 * granule) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    reserve = (reserve + granule - 1) & ~(granule - 1);
+
+#ifdef MAP_HUGETLB
+    // Huge pages are reserved up front (no MAP_NORESERVE), so this
+    // fails instead of faulting later if there aren't enough of them
+    if (flags & COOL_ARENA_VM_HUGE) {
+        base = mmap(
+            NULL, reserve, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0
+        );
+    }
+#endif
+
+    if (base == MAP_FAILED && (flags & COOL_ARENA_VM_HUGE)) {
+        // Fall back to transparent huge pages, which need a range
+        // aligned to the huge page size, so over-reserve and trim
+        base = mmap(
+            NULL, reserve + granule, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+        );
+        if (base == MAP_FAILED) return -1;
+
+        head = -(uintptr_t) base & (granule - 1);
+        if (head > 0) munmap(base, head);
+        munmap(base + head + reserve, granule - head);
+        base += head;
+
+#ifdef MADV_HUGEPAGE
+        madvise(base, reserve, MADV_HUGEPAGE);
+#endif
+    } else if (base == MAP_FAILED) {
+        base = mmap(
+            NULL, reserve, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+        );
+        if (base == MAP_FAILED) return -1;
+    }
+
+    arena->_ptr = base;
+    arena->_end = base;
+    arena->_vm_base = base;
+    arena->_vm_commit = base;
+    arena->_vm_limit = base + reserve;
+    arena->_vm_packed = base;
+    arena->_vm_granule = granule;
+
+    return 0;
+}
+
+/**
+ * The slow path of `_Arena_refill` for arenas
+ * initialized with `Arena_init_vm`, which commits
+ * more of the reserved range.
+ */
+/**
+ * Commits enough whole granules of an arena initialized with
+ * `Arena_init_vm` for its memory to reach a given point,
+ * which must be within the reserved range.
+ */
+static int _Arena_commit_vm(Arena *arena, char *top) {
+    char *commit = arena->_vm_base + (
+        ((uintptr_t) (top - arena->_vm_base)
+            + arena->_vm_granule - 1) & ~(arena->_vm_granule - 1)
+    );
+
+    if (commit > arena->_vm_commit) {
+        if (mprotect(
+            arena->_vm_commit, (uintptr_t) (commit - arena->_vm_commit),
+            PROT_READ | PROT_WRITE
+        ) != 0) {
+            return -1;
+        }
+
+        COOL_ARENA_STAT(
+            arena, reserved, (uintptr_t) (commit - arena->_vm_commit)
+        );
+        arena->_vm_commit = commit;
+    }
+
+    return 0;
+}
+
+/**
+ * The slow path of `_Arena_refill` for arenas
+ * initialized with `Arena_init_vm`, which commits
+ * more of the reserved range.
+ */
+static void *_Arena_refill_vm(Arena *arena, uintptr_t size, uintptr_t align) {
+    char *start = arena->_ptr;
+    uintptr_t room;
+    uintptr_t pad;
+
+    // Packed memory at the top of the bump range can't
+    // be moved, so continue after it
+    if (arena->_end != arena->_vm_packed) start = arena->_vm_packed;
+
+    // Check that the allocation fits in the reserved range
+    room = (uintptr_t) (arena->_vm_limit - start);
+    pad = (align == 1) ? 0 : -(uintptr_t) start & (align - 1);
+
+    if (size > room || pad > room - size) return NULL;
+    if (_Arena_commit_vm(arena, start + pad + size) != 0) return NULL;
+
+    arena->_ptr = start;
+    arena->_end = arena->_vm_commit;
+    arena->_vm_packed = arena->_vm_commit;
+
+    return _Arena_carve(&arena->_ptr, &arena->_end, size, align);
+}
+
+int _Arena_extend_vm(Arena *arena, char *ptr, uintptr_t size) {
+    // Packed memory at the top of the bump range can't be moved
+    if (arena->_end != arena->_vm_packed) return 0;
+
+    if (size > (uintptr_t) (arena->_vm_limit - ptr)) return 0;
+    if (_Arena_commit_vm(arena, ptr + size) != 0) return 0;
+
+    arena->_ptr = ptr + size;
+    arena->_end = arena->_vm_commit;
+    arena->_vm_packed = arena->_vm_commit;
+
+    return 1;
+}
+
+/**
+ * Decommits every granule of an arena initialized with
+ * `Arena_init_vm` after a given point, if nothing is
+ * allocated after it.
+ */
+static void _Arena_decommit_from(Arena *arena, char *from) {
+    char *start;
+
+    if (arena->_end != arena->_vm_packed || from < arena->_ptr) return;
+
+    start = arena->_vm_base + (
+        ((uintptr_t) (from - arena->_vm_base)
+            + arena->_vm_granule - 1) & ~(arena->_vm_granule - 1)
+    );
+
+    if (start < arena->_vm_commit) {
+        madvise(
+            start, (uintptr_t) (arena->_vm_commit - start), MADV_DONTNEED
+        );
+        mprotect(
+            start, (uintptr_t) (arena->_vm_commit - start), PROT_NONE
+        );
+
+        arena->_vm_commit = start;
+
+        if (arena->_end > start) {
+            arena->_end = start;
+            arena->_vm_packed = start;
+        }
+    }
+}
+
+void Arena_decommit(Arena *arena) {
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    char *start;
+    char *stop;
+
+    if (arena->_vm_base == NULL) return;
+
+    // If nothing is allocated after the bump pointer,
+    // decommit every granule after it
+    _Arena_decommit_from(arena, arena->_ptr);
+
+    // Release whole pages between the bump pointer and any
+    // packed memory, leaving them committed
+    start = (char *) (((uintptr_t) arena->_ptr + page - 1) & ~(page - 1));
+    stop = (char *) ((uintptr_t) arena->_end & ~(page - 1));
+
+    if (start < stop) {
+        madvise(start, (uintptr_t) (stop - start), MADV_DONTNEED);
+    }
+}
+
+#else
+
+int _Arena_extend_vm(Arena *arena, char *ptr, uintptr_t size) {
+    (void) arena;
+    (void) ptr;
+    (void) size;
+
+    return 0;
+}
+
+#endif // COOL_ARENA_VM
+
+void *_Arena_refill(Arena *arena, uintptr_t size, uintptr_t align) {
+    uintptr_t new_capacity;
+    uintptr_t needed = size;
+    ArenaRegion *region = arena->_current;
+    ArenaRegion *next;
+    ArenaRegion *new_region;
+    uintptr_t free_size;
+    int roomy;
+
+    // If size is 0, do nothing
+    if (size == 0) return NULL;
+
+#ifdef COOL_ARENA_VM
+    if (arena->_vm_base != NULL) return _Arena_refill_vm(arena, size, align);
+#endif
+
+    // Regions are only aligned by the underlying allocator,
+    // so reserve enough room to align within them
+    if (align > sizeof(uintptr_t)) {
+        // Check for overflows
+        if (needed > UINTPTR_MAX - (align - 1)) return NULL;
+
+        needed += align - 1;
+    }
+
+    // Decide whether the current region is nearly
+    // full and should be retired, or kept as the cursor
+    free_size = (uintptr_t) (arena->_end - arena->_ptr);
+    roomy = region != NULL && free_size >= arena->_retire;
+
+    // Check whether the next region (which is blank, since
+    // only regions up to the cursor are used) has enough memory
+    next = (region == NULL) ? NULL : region->_next;
+
+    if (next != NULL && needed <= next->_alloc_size) {
+        // Keep the cursor only if it has more room left
+        // than the blank region would after the allocation
+        if (roomy && free_size > next->_alloc_size - needed) {
+            // Keep the cursor, and move the blank region
+            // to the front of the arena, behind the cursor
+            region->_next = next->_next;
+            next->_next = arena->_head;
+            arena->_head = next;
+            return _Arena_carve_region(next, size, align);
+        }
+
+        // Retire the current region
+        _Arena_set_current(arena, next);
+        return _Arena_carve(&arena->_ptr, &arena->_end, size, align);
+    }
+
+    // Otherwise, a new region must be allocated.
+
+    // Make room for the header of the region
+    if (needed > UINTPTR_MAX - COOL_ARENA_HEADER_SIZE) return NULL;
+    needed += COOL_ARENA_HEADER_SIZE;
+
+    // Allocations which don't fit in the next region are given
+    // a block of their own, rather than an oversized region which
+    // would be kept by every reset
+    if (needed > arena->_next_size) {
+        return _Arena_alloc_large(arena, size, align, needed);
+    }
+
+    new_capacity = arena->_next_size;
+
+    // Likewise, keep the cursor only if it has more
+    // room left than the new region would
+    roomy = roomy && free_size > new_capacity - needed;
+
+    // Try allocating a region for the arena
+    COOL_TRACE_BEGIN("Arena region");
+    new_region = _Arena_region_new(arena, new_capacity);
+    COOL_TRACE_END("Arena region");
+
+    if (new_region == NULL) return NULL;
+
+    COOL_ARENA_STAT(arena, region_allocs, 1);
+    COOL_ARENA_STAT(
+        arena, reserved, new_region->_alloc_size + COOL_ARENA_HEADER_SIZE
+    );
+
+    // Grow the size of the next region
+    if (arena->_next_size > arena->_max_size / arena->_growth) {
+        arena->_next_size = arena->_max_size;
+    } else {
+        arena->_next_size *= arena->_growth;
+    }
+
+    if (region == NULL) {
+        // This is the first region of the arena
+        new_region->_next = NULL;
+        arena->_head = new_region;
+    } else if (roomy) {
+        // The current region still has plenty of room, so keep
+        // the cursor where it is and place the new region at the
+        // front of the arena, behind the cursor
+        new_region->_next = arena->_head;
+        arena->_head = new_region;
+        return _Arena_carve_region(new_region, size, align);
+    } else {
+        // Retire the current region and insert the new region
+        // directly after it
+        new_region->_next = region->_next;
+        region->_next = new_region;
+    }
+
+    _Arena_set_current(arena, new_region);
+    return _Arena_carve(&arena->_ptr, &arena->_end, size, align);
 }
 
 void Arena_reset(Arena *arena) {
-    // Iterate over all regions and reset size
-    while (arena != NULL) {
-        arena->_size = 0;
-        arena = arena->_next;
+    Arena_reset_ex(arena, 0);
+}
+
+void Arena_reset_ex(Arena *arena, int flags) {
+    ArenaRegion *region = arena->_head;
+    ArenaRegion *next;
+    ArenaRegion **link;
+    uintptr_t used;
+    uintptr_t budget;
+    uintptr_t kept = 0;
+    uintptr_t owned = 0;
+    uintptr_t owned_size = 0;
+
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_RESET, 0, flags);
+    COOL_TRACE_BEGIN("Arena_reset");
+
+    _Arena_free_large(arena, NULL);
+
+    // Blocks returned by children are about to be reset
+    arena->_spare = NULL;
+
+    // Calculate how much memory was used since the last reset
+    used = _Arena_used(arena);
+    COOL_TRACE_COUNTER("Arena used", used);
+
+    // Update the high-water mark
+    arena->_peak -= arena->_peak >> COOL_ARENA_PEAK_DECAY;
+    if (used > arena->_peak) arena->_peak = used;
+
+#ifdef COOL_STATS
+    arena->_stats.resets++;
+    if (used > arena->_stats.peak) arena->_stats.peak = used;
+#endif
+
+    budget = (arena->_retain != 0) ? arena->_retain : arena->_peak;
+
+    // Move the bump pointer back to the start of the range
+    if (arena->_vm_base != NULL) {
+        arena->_ptr = arena->_vm_base;
+        arena->_end = arena->_vm_commit;
+        arena->_vm_packed = arena->_vm_commit;
+
+#ifdef COOL_ARENA_VM
+        if (flags & (COOL_ARENA_RESET_TRIM | COOL_ARENA_RESET_CONSOLIDATE)) {
+            _Arena_decommit_from(
+                arena,
+                arena->_vm_base + (
+                    (uintptr_t) (arena->_vm_limit - arena->_vm_base) < budget
+                        ? (uintptr_t) (arena->_vm_limit - arena->_vm_base)
+                        : budget
+                )
+            );
+        }
+#endif
+
+        COOL_TRACE_END("Arena_reset");
+        return;
+    }
+
+    // The buffer supplied by the caller is always kept,
+    // so only the rest of the budget is for other regions
+    if (arena->_buffer != NULL) {
+        kept = arena->_buffer->_alloc_size;
+        budget = (budget > kept) ? budget - kept : 0;
+    }
+
+    for (region = arena->_head; region != NULL; region = region->_next) {
+        if (region == arena->_buffer) continue;
+
+        owned++;
+        owned_size += region->_alloc_size;
+    }
+
+    if ((flags & COOL_ARENA_RESET_CONSOLIDATE)
+        && (owned > 1 || (owned == 1
+            && (owned_size < budget || owned_size / 2 > budget)))) {
+        // Replace all regions (but the buffer) with a single one
+        region = arena->_head;
+
+        while (region != NULL) {
+            next = region->_next;
+            _Arena_region_free(arena, region);
+            region = next;
+        }
+
+        budget = COOL_ARENA_ROUND(budget);
+        region = (budget == 0 || budget > UINTPTR_MAX - COOL_ARENA_HEADER_SIZE)
+            ? NULL
+            : _Arena_region_new(arena, budget + COOL_ARENA_HEADER_SIZE);
+
+        if (region != NULL) {
+            COOL_ARENA_STAT(arena, region_allocs, 1);
+            COOL_ARENA_STAT(
+                arena, reserved, region->_alloc_size + COOL_ARENA_HEADER_SIZE
+            );
+        }
+
+        if (arena->_buffer != NULL) {
+            arena->_buffer->_next = region;
+            region = arena->_buffer;
+        }
+
+        arena->_head = region;
+    } else if (flags & COOL_ARENA_RESET_TRIM) {
+        // Keep regions until the budget is reached
+        kept = 0;
+        link = &arena->_head;
+
+        while (*link != NULL && kept < budget) {
+            if (*link != arena->_buffer) kept += (*link)->_alloc_size;
+            link = &(*link)->_next;
+        }
+
+        region = *link;
+        *link = NULL;
+
+        while (region != NULL) {
+            next = region->_next;
+
+            // Keep the buffer at the end
+            if (region == arena->_buffer) {
+                *link = region;
+                link = &region->_next;
+                *link = NULL;
+            } else {
+                _Arena_region_free(arena, region);
+            }
+
+            region = next;
+        }
+    }
+
+    _Arena_blank(arena);
+    COOL_TRACE_END("Arena_reset");
+}
+
+void Arena_set_retain(Arena *arena, uintptr_t size) {
+    arena->_retain = size;
+}
+
+void Arena_init_child(Arena *child, Arena *parent) {
+    Arena_init_ex(
+        child, parent->_def_size / 4, parent->_growth, parent->_max_size / 4
+    );
+
+    child->_borrow.alloc = _Arena_child_alloc;
+    child->_borrow.realloc = _Arena_child_realloc;
+    child->_borrow.free = _Arena_child_free;
+    child->_borrow.ctx = parent;
+    child->_allocator = &child->_borrow;
+}
+
+void Arena_set_allocator(Arena *arena, const Allocator *allocator) {
+    arena->_allocator = allocator;
+}
+
+uintptr_t Arena_peak(Arena *arena) {
+    return arena->_peak;
+}
+
+void *Arena_realloc(
+    Arena *arena, void *ptr, uintptr_t old_size, uintptr_t new_size
+) {
+    char *top;
+    char *mem;
+
+    if (ptr == NULL) return Arena_alloc(arena, new_size);
+
+    if (new_size == 0) {
+        Arena_pop(arena, ptr, old_size);
+        return NULL;
+    }
+
+    // Try resizing in place
+    if (Arena_extend(arena, ptr, old_size, new_size)) return ptr;
+
+    // Shrinking anything else can't release its memory,
+    // but the allocation still fits where it is
+    if (new_size <= old_size) return ptr;
+
+    // If this is the most recent allocation, release it first,
+    // as the new allocation won't fit in its place anyway
+    top = arena->_ptr;
+    Arena_pop(arena, ptr, old_size);
+
+    mem = (char *) Arena_alloc(arena, new_size);
+
+    if (mem == NULL) {
+        arena->_ptr = top;
+        return NULL;
+    }
+
+    // The new allocation may start where the old one did, in which
+    // case there's nothing to copy. Otherwise, they don't overlap,
+    // and nothing else has been allocated over the old one
+    if (mem == ptr) return mem;
+
+    memcpy(mem, ptr, (old_size < new_size) ? old_size : new_size);
+
+    COOL_ARENA_STAT(arena, reallocs, 1);
+    COOL_ARENA_STAT(
+        arena, copied, (old_size < new_size) ? old_size : new_size
+    );
+
+    return mem;
+}
+
+void Arena_rewind(Arena *arena, ArenaMark mark) {
+    ArenaRegion *region;
+    ArenaRegion *next;
+
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_REWIND, mark._id, 0);
+
+    _Arena_free_large(arena, mark._large);
+
+    // Blocks returned by children may have been allocated
+    // after the mark, so aren't kept
+    arena->_spare = NULL;
+
+    // The range of a virtual memory arena is contiguous,
+    // so only the bump pointers need to be moved back, along
+    // with the top of the packed memory, so that memory
+    // committed since the mark is used again
+    if (arena->_vm_base != NULL) {
+        arena->_ptr = mark._ptr;
+        arena->_end = mark._end;
+        arena->_vm_packed = mark._vm_packed;
+
+        // Memory decommitted since the mark can't be allocated from
+        if (arena->_end > arena->_vm_commit) {
+            arena->_end = arena->_vm_commit;
+            arena->_vm_packed = arena->_vm_commit;
+        }
+
+        return;
+    }
+
+    // If the arena was blank, all of its regions
+    // were allocated after the mark
+    if (mark._current == NULL) {
+        _Arena_blank(arena);
+        return;
+    }
+
+    // Reset the regions the cursor has passed since the mark
+    if (arena->_current != mark._current) {
+        region = mark._current->_next;
+
+        for (;;) {
+            region->_size = 0;
+            if (region == arena->_current) break;
+            region = region->_next;
+        }
+    }
+
+    // Regions placed at the front of the arena since the mark
+    // were only used since the mark, so reset them and move them
+    // after the cursor, where they can be used again
+    region = arena->_head;
+
+    while (region != mark._head) {
+        next = region->_next;
+
+        region->_size = 0;
+        region->_next = mark._current->_next;
+        mark._current->_next = region;
+
+        region = next;
     }
+
+    arena->_head = mark._head;
+
+    // Move the cursor back
+    arena->_ptr = mark._ptr;
+    arena->_end = mark._end;
+    arena->_current = mark._current;
 }
 
 void Arena_free(Arena *arena) {
-    Arena *prev = NULL;
+    ArenaRegion *region = arena->_head;
+    ArenaRegion *next;
+
+    COOL_ARENA_TRACE_EVENT(arena, COOL_ARENA_TRACE_FREE, 0, 0);
+
+#ifdef COOL_ARENA_VM
+    if (arena->_vm_base != NULL) {
+        munmap(
+            arena->_vm_base,
+            (uintptr_t) (arena->_vm_limit - arena->_vm_base)
+        );
+    }
+#endif
 
     // Iterate over all regions and free them
-    while (arena != NULL) {
-        // Free the region
-        COOL_ARENA_FUNC_FREE(arena->_region);
-        arena->_region = NULL;
+    while (region != NULL) {
+        next = region->_next;
 
-        // Store the current arena
-        prev = arena;
+        // Free the region and its metadata
+        _Arena_region_free(arena, region);
 
-        // Move to the next, set the current arena's
-        // next value
-        arena = arena->_next;
-        prev->_next = NULL;
+        region = next;
     }
+
+    _Arena_free_large(arena, NULL);
+    _Arena_clear(arena);
 }
 
 void Arena_dump(Arena *arena) {
+    ArenaRegion *region = arena->_head;
+    uintptr_t size;
+
     printf(
-        "_region:     %p\n"
-        "_size:       %lu\n"
-        "_alloc_size: %lu\n"
-        "_next:       %p\n"
-        "== region contents ==\n",
-        (void *) arena->_region, arena->_size,
-        arena->_alloc_size, (void *) arena->_next
+        "_ptr:        %p\n"
+        "_end:        %p\n"
+        "_head:       %p\n"
+        "_current:    %p\n"
+        "_large:      %p\n",
+        (void *) arena->_ptr, (void *) arena->_end,
+        (void *) arena->_head, (void *) arena->_current,
+        (void *) arena->_large
     );
 
-    if (arena->_region != NULL) {
-        for (uintptr_t i = 0; i < arena->_alloc_size; i++) {
-            if ((i + 1) % 20 == 0) printf("%#lx\n", arena->_region[i]);
-            else printf("%#lx ", arena->_region[i]);
+    if (arena->_vm_base != NULL) {
+        printf(
+            "_vm_base:    %p\n"
+            "_vm_commit:  %p\n"
+            "_vm_limit:   %p\n"
+            "_vm_packed:  %p\n"
+            "_vm_granule: %lu\n",
+            (void *) arena->_vm_base, (void *) arena->_vm_commit,
+            (void *) arena->_vm_limit, (void *) arena->_vm_packed,
+            arena->_vm_granule
+        );
+        return;
+    }
+
+    if (region == NULL) puts("Arena is blank");
+
+    while (region != NULL) {
+        // The size of the current region is tracked by the bump pointers
+        size = (region == arena->_current)
+            ? _Arena_current_size(arena)
+            : region->_size;
+
+        printf(
+            "\n"
+            "_region:     %p\n"
+            "_size:       %lu\n"
+            "_alloc_size: %lu\n"
+            "_next:       %p\n"
+            "== region contents ==\n",
+            (void *) region->_region, size,
+            region->_alloc_size, (void *) region->_next
+        );
+
+        for (uintptr_t i = 0; i < region->_alloc_size / sizeof(uintptr_t); i++) {
+            if ((i + 1) % 20 == 0) printf("%#lx\n", region->_region[i]);
+            else printf("%#lx ", region->_region[i]);
         }
-    } else {
-        puts("Region is blank");
+        puts("");
+
+        region = region->_next;
+    }
+
+    // Large blocks are only summarized
+    for (region = arena->_large; region != NULL; region = region->_next) {
+        printf(
+            "\n"
+            "_region:     %p (large)\n"
+            "_alloc_size: %lu\n"
+            "_next:       %p\n",
+            (void *) region->_region,
+            region->_alloc_size, (void *) region->_next
+        );
+    }
+}
+
+#ifdef COOL_ARENA_TRACE
+
+static FILE *_Atomic _arena_trace_stream;
+static struct timespec _arena_trace_origin;
+static atomic_uint _arena_trace_threads;
+static _Thread_local uint16_t _arena_trace_thread;
+
+/**
+ * Reads the clock operations are timed with, which is
+ * monotonic, unless `clock_gettime(2)` isn't available.
+ */
+static void _Arena_trace_clock(struct timespec *ts) {
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    timespec_get(ts, TIME_UTC);
+#endif
+}
+
+int Arena_trace_start(FILE *stream) {
+    if (fwrite(COOL_ARENA_TRACE_MAGIC, 1, 8, stream) != 8) return -1;
+
+    _Arena_trace_clock(&_arena_trace_origin);
+    atomic_store(&_arena_trace_stream, stream);
+
+    return 0;
+}
+
+void Arena_trace_stop(void) {
+    FILE *stream = atomic_exchange(&_arena_trace_stream, NULL);
+
+    if (stream != NULL) fflush(stream);
+}
+
+void _Arena_trace(Arena *arena, int op, uintptr_t size, uintptr_t arg) {
+    FILE *stream = atomic_load_explicit(
+        &_arena_trace_stream, memory_order_relaxed
+    );
+    ArenaTraceRecord record;
+    struct timespec now;
+
+    if (stream == NULL) return;
+
+    // Number threads as they record their first operation
+    if (_arena_trace_thread == 0) {
+        _arena_trace_thread = (uint16_t) (
+            atomic_fetch_add(&_arena_trace_threads, 1) + 1
+        );
+    }
+
+    _Arena_trace_clock(&now);
+
+    record.time = (uint64_t) (
+        (int64_t) (now.tv_sec - _arena_trace_origin.tv_sec) * 1000000000
+        + (now.tv_nsec - _arena_trace_origin.tv_nsec)
+    );
+    record.arena = (uint64_t) (uintptr_t) arena;
+    record.size = size;
+    record.arg = (uint32_t) arg;
+    record.thread = _arena_trace_thread;
+    record.op = (uint16_t) op;
+
+    fwrite(&record, sizeof(record), 1, stream);
+}
+
+#endif // COOL_ARENA_TRACE
+
+#ifdef COOL_STATS
+
+ArenaStats Arena_stats(Arena *arena) {
+    ArenaStats stats = arena->_stats;
+    ArenaRegion *region;
+
+    stats.regions = 0;
+    stats.capacity = 0;
+    stats.in_use = _Arena_used(arena);
+
+    if (arena->_vm_base != NULL) {
+        stats.capacity = (uintptr_t) (arena->_vm_commit - arena->_vm_base);
+    }
+
+    for (region = arena->_head; region != NULL; region = region->_next) {
+        stats.regions++;
+        stats.capacity += region->_alloc_size;
     }
-    puts("");
+
+    if (stats.in_use > arena->_stats.peak) arena->_stats.peak = stats.in_use;
+    stats.peak = arena->_stats.peak;
+
+    return stats;
+}
+
+void Arena_stats_json(Arena *arena, FILE *stream) {
+    ArenaStats stats = Arena_stats(arena);
+
+    fprintf(
+        stream,
+        "{\"allocs\": %lu, \"requested\": %lu, "
+        "\"reallocs\": %lu, \"copied\": %lu, "
+        "\"region_allocs\": %lu, \"large_allocs\": %lu, "
+        "\"reserved\": %lu, \"wasted\": %lu, \"resets\": %lu, "
+        "\"regions\": %lu, \"capacity\": %lu, "
+        "\"in_use\": %lu, \"peak\": %lu}\n",
+        stats.allocs, stats.requested,
+        stats.reallocs, stats.copied,
+        stats.region_allocs, stats.large_allocs,
+        stats.reserved, stats.wasted, stats.resets,
+        stats.regions, stats.capacity,
+        stats.in_use, stats.peak
+    );
 }
 
+#endif // COOL_STATS
+
 #endif // COOL_ARENA_IMPL
 
 #endif // _COOL_ARENA_H
@@ -0,0 +1,523 @@
+#ifndef _COOL_ATOMIC_ARENA_H
+#define _COOL_ATOMIC_ARENA_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Hints used to keep the fast path of `AtomicArena_alloc`
+ * small, and the refill path out of line.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define COOL_ATOMIC_ARENA_LIKELY(X) __builtin_expect(!!(X), 1)
+#define COOL_ATOMIC_ARENA_COLD __attribute__((cold, noinline))
+#else
+#define COOL_ATOMIC_ARENA_LIKELY(X) (X)
+#define COOL_ATOMIC_ARENA_COLD
+#endif
+
+typedef struct AtomicArenaRegion {
+    _Atomic uintptr_t _size;
+    uintptr_t _alloc_size;
+    struct AtomicArenaRegion *_next;
+    struct AtomicArenaRegion *_spare_next;
+} AtomicArenaRegion;
+
+typedef struct AtomicArena {
+    _Atomic(AtomicArenaRegion *) _current;
+    _Atomic(AtomicArenaRegion *) _regions;
+    _Atomic(AtomicArenaRegion *) _spare;
+    _Atomic(AtomicArenaRegion *) _standby;
+    _Atomic uintptr_t _generation;
+    uintptr_t _def_size;
+} AtomicArena;
+
+/**
+ * The quantity of bytes at the start of each region
+ * taken up by its `AtomicArenaRegion` header.
+ *
+ * This keeps the memory after the header aligned as
+ * strictly as the underlying allocator does.
+ */
+#define COOL_ATOMIC_ARENA_HEADER_SIZE                         \
+    ((sizeof(AtomicArenaRegion) + _Alignof(max_align_t) - 1) \
+        & ~(_Alignof(max_align_t) - 1))
+
+/**
+ * Initializes an `AtomicArena` struct.
+ *
+ * An `AtomicArena` can be allocated from by many threads
+ * at once, without any locking. All other functions must
+ * not be called while other threads are using the arena.
+ *
+ * For example:
+ * ```
+ * AtomicArena arena;
+ * AtomicArena_init(&arena);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to initialize.
+ */
+void AtomicArena_init(AtomicArena *arena);
+
+/**
+ * Installs a new region in the arena, then allocates
+ * a given quantity of memory within it.
+ *
+ * This is the out of line slow path of `AtomicArena_alloc`,
+ * and is only called when the current region does not have
+ * enough free memory. It should not be called directly.
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate, which must
+ *             be a multiple of `sizeof(uintptr_t)`.
+ * @return A pointer on success, NULL otherwise.
+ */
+COOL_ATOMIC_ARENA_COLD void *_AtomicArena_refill(
+    AtomicArena *arena, uintptr_t size
+);
+
+/**
+ * Allocates a given quantity of memory within the arena.
+ * This may be called by many threads at once.
+ *
+ * The size is rounded up to a multiple of `sizeof(uintptr_t)`.
+ *
+ * Allocating within the current region is a single atomic
+ * fetch-and-add on its size. When the current region is full,
+ * a new region (either left over from `AtomicArena_reset`, or
+ * newly allocated) is installed with a compare-and-swap, so no
+ * thread ever waits on another. If several threads race to
+ * install a region, the losers allocate in the winner's region,
+ * and keep theirs on standby for the next refill.
+ *
+ * Allocations larger than a region get a region of their own,
+ * which is not installed as the current region.
+ *
+ * For example:
+ * ```
+ * AtomicArena arena;
+ *
+ * // ----
+ *
+ * // From any thread
+ * char *mem = AtomicArena_alloc(&arena, 1024);
+ *
+ * // Check for failure
+ * if (mem == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *AtomicArena_alloc(AtomicArena *arena, uintptr_t size) {
+    AtomicArenaRegion *region;
+    uintptr_t offset;
+
+    // Round size up to a multiple of the word size
+    size = (size + sizeof(uintptr_t) - 1) & ~(uintptr_t) (sizeof(uintptr_t) - 1);
+
+    region = atomic_load_explicit(&arena->_current, memory_order_acquire);
+
+    // A size of 0 (including one which overflowed while
+    // rounding) wraps around here, so takes the slow path
+    if (COOL_ATOMIC_ARENA_LIKELY(
+        region != NULL && size - 1 < region->_alloc_size
+    )) {
+        offset = atomic_fetch_add_explicit(
+            &region->_size, size, memory_order_relaxed
+        );
+
+        if (COOL_ATOMIC_ARENA_LIKELY(offset <= region->_alloc_size - size)) {
+            return (char *) region + COOL_ATOMIC_ARENA_HEADER_SIZE + offset;
+        }
+    }
+
+    return _AtomicArena_refill(arena, size);
+}
+
+/**
+ * Resets the arena.
+ *
+ * All currently allocated regions will remain, but
+ * they will be reset, so that memory can be allocated within
+ * them once more. Regions made for a single large allocation
+ * are freed.
+ *
+ * This also advances the generation of the arena, so that
+ * the buffer of every thread of a `TlabArena` carved out of
+ * it is discarded on its next allocation.
+ *
+ * This must not be called while other
+ * threads are using the arena.
+ *
+ * For example:
+ * ```
+ * AtomicArena arena;
+ *
+ * // ----
+ *
+ * AtomicArena_reset(&arena);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to reset.
+ */
+void AtomicArena_reset(AtomicArena *arena);
+
+/**
+ * Frees the arena.
+ *
+ * Each region will individually be freed and
+ * the arena will be reinitialized.
+ *
+ * This must not be called while other
+ * threads are using the arena.
+ *
+ * For example:
+ * ```
+ * AtomicArena arena;
+ *
+ * // ----
+ *
+ * AtomicArena_free(&arena);
+ *
+ * ```
+ */
+void AtomicArena_free(AtomicArena *arena);
+
+/**
+ * Dumps the regions of the arena to stdout.
+ *
+ * Quite useful for debugging.
+ *
+ * This must not be called while other
+ * threads are using the arena.
+ *
+ * For example:
+ * ```
+ * AtomicArena arena;
+ *
+ * // ----
+ *
+ * AtomicArena_dump(&arena);
+ *
+ * // ----
+ *
+ * ```
+ */
+void AtomicArena_dump(AtomicArena *arena);
+
+#ifdef COOL_ATOMIC_ARENA_IMPL
+
+/**
+ * The default quantity of bytes to allocate
+ * to each region in the arena, including its header.
+ *
+ * This is larger than for `Arena`, as each new region
+ * is a point where threads may contend.
+ */
+#ifndef COOL_ATOMIC_ARENA_DEF_SIZE
+#define COOL_ATOMIC_ARENA_DEF_SIZE 64 * 1024
+#endif
+
+/**
+ * The underlying function for allocating
+ * memory for regions.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `malloc(3)`,
+ * and must be thread-safe.
+ *
+ * This function must also return a valid pointer
+ * on success, and NULL on failure.
+ */
+#ifndef COOL_ATOMIC_ARENA_FUNC_ALLOC
+#include <stdlib.h>
+#define COOL_ATOMIC_ARENA_FUNC_ALLOC malloc
+#endif
+
+/**
+ * The underlying function for freeing
+ * memory for a region.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `free(3)`
+ */
+#ifndef COOL_ATOMIC_ARENA_FUNC_FREE
+#include <stdlib.h>
+#define COOL_ATOMIC_ARENA_FUNC_FREE free
+#endif
+
+void AtomicArena_init(AtomicArena *arena) {
+    atomic_init(&arena->_current, NULL);
+    atomic_init(&arena->_regions, NULL);
+    atomic_init(&arena->_spare, NULL);
+    atomic_init(&arena->_standby, NULL);
+    atomic_init(&arena->_generation, 0);
+    arena->_def_size = COOL_ATOMIC_ARENA_DEF_SIZE;
+}
+
+/**
+ * Takes a region left over from `AtomicArena_reset`
+ * which can hold a given quantity of bytes, if there is one.
+ *
+ * Regions are only ever pushed onto the spare list while
+ * the arena is not in use, so popping is safe from ABA.
+ */
+static AtomicArenaRegion *_AtomicArena_take_spare(
+    AtomicArena *arena, uintptr_t size
+) {
+    AtomicArenaRegion *region = atomic_load_explicit(
+        &arena->_spare, memory_order_acquire
+    );
+
+    while (region != NULL && size <= region->_alloc_size) {
+        if (atomic_compare_exchange_weak_explicit(
+            &arena->_spare, &region, region->_spare_next,
+            memory_order_acq_rel, memory_order_acquire
+        )) {
+            return region;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Pushes a chain of blank regions, linked by `_spare_next`,
+ * onto the standby list of the arena.
+ *
+ * Unlike the spare list, regions are pushed onto the standby
+ * list while the arena is in use, so it is only ever emptied
+ * as a whole (see `_AtomicArena_take_standby`), which is safe
+ * from ABA, where popping a single region is not.
+ */
+static void _AtomicArena_park(
+    AtomicArena *arena, AtomicArenaRegion *first, AtomicArenaRegion *last
+) {
+    AtomicArenaRegion *head = atomic_load_explicit(
+        &arena->_standby, memory_order_relaxed
+    );
+
+    do {
+        last->_spare_next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &arena->_standby, &head, first,
+        memory_order_release, memory_order_relaxed
+    ));
+}
+
+/**
+ * Takes a region kept on standby by a thread which lost
+ * the race to install it, if there is one.
+ */
+static AtomicArenaRegion *_AtomicArena_take_standby(AtomicArena *arena) {
+    AtomicArenaRegion *region;
+    AtomicArenaRegion *last;
+
+    if (atomic_load_explicit(&arena->_standby, memory_order_relaxed) == NULL) {
+        return NULL;
+    }
+
+    region = atomic_exchange_explicit(
+        &arena->_standby, NULL, memory_order_acquire
+    );
+
+    // Put back any others
+    if (region != NULL && region->_spare_next != NULL) {
+        for (last = region->_spare_next;
+            last->_spare_next != NULL;
+            last = last->_spare_next);
+
+        _AtomicArena_park(arena, region->_spare_next, last);
+    }
+
+    return region;
+}
+
+void *_AtomicArena_refill(AtomicArena *arena, uintptr_t size) {
+    AtomicArenaRegion *current;
+    AtomicArenaRegion *region;
+    AtomicArenaRegion *head;
+    uintptr_t capacity;
+    uintptr_t offset;
+    int dedicated;
+
+    // If size is 0, do nothing
+    if (size == 0 || size > UINTPTR_MAX - COOL_ATOMIC_ARENA_HEADER_SIZE) {
+        return NULL;
+    }
+
+    // Another thread may have installed a new region already
+    current = atomic_load_explicit(&arena->_current, memory_order_acquire);
+
+    if (current != NULL && size <= current->_alloc_size) {
+        offset = atomic_fetch_add_explicit(
+            &current->_size, size, memory_order_relaxed
+        );
+
+        if (offset <= current->_alloc_size - size) {
+            return (char *) current + COOL_ATOMIC_ARENA_HEADER_SIZE + offset;
+        }
+    }
+
+    // Allocations which don't fit in a normal region
+    // get a region of their own
+    capacity = arena->_def_size;
+    dedicated = size > capacity - COOL_ATOMIC_ARENA_HEADER_SIZE;
+    if (dedicated) capacity = size + COOL_ATOMIC_ARENA_HEADER_SIZE;
+
+    region = dedicated ? NULL : _AtomicArena_take_standby(arena);
+    if (region == NULL) region = _AtomicArena_take_spare(arena, size);
+
+    if (region == NULL) {
+        region = (AtomicArenaRegion *) COOL_ATOMIC_ARENA_FUNC_ALLOC(capacity);
+        if (region == NULL) return NULL;
+
+        region->_alloc_size = capacity - COOL_ATOMIC_ARENA_HEADER_SIZE;
+        region->_spare_next = NULL;
+
+        // Record the region, so that it can be reset and freed
+        head = atomic_load_explicit(&arena->_regions, memory_order_relaxed);
+
+        do {
+            region->_next = head;
+        } while (!atomic_compare_exchange_weak_explicit(
+            &arena->_regions, &head, region,
+            memory_order_release, memory_order_relaxed
+        ));
+    }
+
+    // Reserve the allocation before other threads can see the region
+    atomic_store_explicit(&region->_size, size, memory_order_relaxed);
+
+    if (dedicated) return (char *) region + COOL_ATOMIC_ARENA_HEADER_SIZE;
+
+    // Try installing the region as the current one
+    while (!atomic_compare_exchange_strong_explicit(
+        &arena->_current, &current, region,
+        memory_order_acq_rel, memory_order_acquire
+    )) {
+        // Another thread got there first, so try allocating in
+        // its region, and keep this one for the next refill
+        if (current != NULL && size <= current->_alloc_size) {
+            offset = atomic_fetch_add_explicit(
+                &current->_size, size, memory_order_relaxed
+            );
+
+            if (offset <= current->_alloc_size - size) {
+                atomic_store_explicit(&region->_size, 0, memory_order_relaxed);
+                _AtomicArena_park(arena, region, region);
+
+                return (char *) current + COOL_ATOMIC_ARENA_HEADER_SIZE
+                    + offset;
+            }
+        }
+
+        // Its region is already full, so try again
+    }
+
+    return (char *) region + COOL_ATOMIC_ARENA_HEADER_SIZE;
+}
+
+void AtomicArena_reset(AtomicArena *arena) {
+    AtomicArenaRegion *region = atomic_load(&arena->_regions);
+    AtomicArenaRegion *regions = NULL;
+    AtomicArenaRegion *spare = NULL;
+    AtomicArenaRegion *next;
+
+    // Iterate over all regions, reset size,
+    // and make them available again
+    while (region != NULL) {
+        next = region->_next;
+
+        // Free regions made for a single large allocation,
+        // as they're rarely reused
+        if (region->_alloc_size
+            != arena->_def_size - COOL_ATOMIC_ARENA_HEADER_SIZE) {
+            COOL_ATOMIC_ARENA_FUNC_FREE(region);
+        } else {
+            atomic_store_explicit(&region->_size, 0, memory_order_relaxed);
+            region->_next = regions;
+            regions = region;
+            region->_spare_next = spare;
+            spare = region;
+        }
+
+        region = next;
+    }
+
+    atomic_store(&arena->_regions, regions);
+    atomic_store(&arena->_spare, spare);
+    atomic_store(&arena->_standby, NULL);
+    atomic_store(&arena->_current, NULL);
+    atomic_fetch_add(&arena->_generation, 1);
+}
+
+void AtomicArena_free(AtomicArena *arena) {
+    AtomicArenaRegion *region = atomic_load(&arena->_regions);
+    AtomicArenaRegion *next;
+    uintptr_t generation = atomic_load(&arena->_generation);
+
+    // Iterate over all regions and free them
+    while (region != NULL) {
+        next = region->_next;
+        COOL_ATOMIC_ARENA_FUNC_FREE(region);
+        region = next;
+    }
+
+    // Keep the generation going, as TLABs may outlive the arena
+    AtomicArena_init(arena);
+    atomic_store(&arena->_generation, generation + 1);
+}
+
+void AtomicArena_dump(AtomicArena *arena) {
+    AtomicArenaRegion *region = atomic_load(&arena->_regions);
+    uintptr_t size;
+
+    printf(
+        "_current:    %p\n"
+        "_regions:    %p\n"
+        "_spare:      %p\n"
+        "_standby:    %p\n",
+        (void *) atomic_load(&arena->_current),
+        (void *) region,
+        (void *) atomic_load(&arena->_spare),
+        (void *) atomic_load(&arena->_standby)
+    );
+
+    if (region == NULL) puts("Arena is blank");
+
+    while (region != NULL) {
+        // The size may have overshot the end of a full region
+        size = atomic_load(&region->_size);
+        if (size > region->_alloc_size) size = region->_alloc_size;
+
+        printf(
+            "\n"
+            "_region:     %p\n"
+            "_size:       %lu\n"
+            "_alloc_size: %lu\n"
+            "_next:       %p\n",
+            (void *) region, size,
+            region->_alloc_size, (void *) region->_next
+        );
+
+        region = region->_next;
+    }
+}
+
+#endif // COOL_ATOMIC_ARENA_IMPL
+
+#endif // _COOL_ATOMIC_ARENA_H
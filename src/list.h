@@ -1,6 +1,11 @@
 #ifndef _COOL_LIST_H
 #define _COOL_LIST_H
 
+#include <stdint.h>
+
+#include "allocator.h"
+#include "trace.h"
+
 /**
  * The default quantity of bytes to allocate
  * to lists when using `List_init`.
@@ -11,7 +16,12 @@
 
 /**
  * The underlying function for allocating
- * memory for a list.
+ * memory for a list, unless it was initialized
+ * with an allocator (see `List_init_allocator`).
+ *
+ * These functions are called directly, so they are
+ * the fastest choice when the allocator of every list
+ * is known at compile time.
  *
  * This function can be changed, but it must have
  * the same function signature as `malloc(3)`.
@@ -54,6 +64,44 @@
 #define COOL_LIST_FUNC_FREE free
 #endif
 
+#ifdef COOL_STATS
+
+#include <string.h>
+
+/**
+ * Statistics about how a list has grown since it
+ * was initialized, returned by `List_stats`.
+ *
+ * This is only available if `COOL_STATS` is defined.
+ */
+typedef struct ListStats {
+    // The quantity of values pushed
+    size_t pushes;
+
+    // The quantity of times the list grew, and of bytes
+    // copied when `realloc(3)` had to move the list
+    size_t reallocs;
+    size_t copied;
+
+    // The most values the list has held at once
+    size_t peak;
+} ListStats;
+
+#define _COOL_LIST_STATS ListStats _stats;
+
+/**
+ * Updates a field of the statistics of a list,
+ * or does nothing unless `COOL_STATS` is defined.
+ */
+#define COOL_LIST_STAT(R, F, N) ((R)._stats.F += (N))
+
+#else
+
+#define _COOL_LIST_STATS
+#define COOL_LIST_STAT(R, F, N) ((void) 0)
+
+#endif // COOL_STATS
+
 /**
  * Declares a list to hold a given type.
  *
@@ -74,6 +122,8 @@
     size_t _alloc_size;                 \
     size_t size;                        \
     int error;                          \
+    const Allocator *_allocator;        \
+    _COOL_LIST_STATS                    \
 } N
 
 /**
@@ -103,8 +153,54 @@
 #define List_init_sized(R, S) {            \
     (R).size = 0;                          \
     (R)._alloc_size = (S);                 \
+    (R)._allocator = NULL;                 \
     (R).buf = COOL_LIST_FUNC_ALLOC((S));   \
     (R).error = ((R).buf == NULL) ? 1 : 0; \
+    _List_stats_init(R);                   \
+}
+
+/**
+ * Initializes a list with a given size, which allocates
+ * its memory with a given allocator (see `Allocator`),
+ * rather than `COOL_LIST_FUNC_ALLOC` and friends.
+ *
+ * This way, a list can keep its memory in any
+ * allocator chosen at runtime, such as an arena
+ * (see `List_init_arena`).
+ *
+ * If an error occurs during allocation, the `error`
+ * field will be set to `1`.
+ *
+ * For example:
+ * ```
+ * ListType(MyCharList, char);
+ * MyCharList list;
+ * Allocator allocator;
+ *
+ * // ----
+ *
+ * // Allocate a list to store 1024 chars with the allocator
+ * List_init_allocator(list, 1024 * sizeof(char), &allocator);
+ *
+ * // Check for errors
+ * if (list.error) {
+ *     perror("malloc");
+ * }
+ * ```
+ *
+ * @param R The list to initialize.
+ * @param S The quantity of bytes to be allocated
+ *          to the list initially.
+ * @param A A pointer to the allocator, which
+ *          must outlive the list.
+ */
+#define List_init_allocator(R, S, A) {              \
+    (R).size = 0;                                   \
+    (R)._alloc_size = (S);                          \
+    (R)._allocator = (A);                           \
+    (R).buf = Allocator_alloc((R)._allocator, (S)); \
+    (R).error = ((R).buf == NULL) ? 1 : 0;          \
+    _List_stats_init(R);                            \
 }
 
 /**
@@ -132,6 +228,53 @@
  */
 #define List_init(R) List_init_sized(R, COOL_LIST_DEF_SIZE)
 
+/**
+ * Initializes a list with a given size, which keeps
+ * its memory in an arena (see `Arena_allocator`).
+ *
+ * While the list is the most recent allocation in the arena,
+ * it grows in place. Otherwise, it is moved elsewhere within
+ * the arena. Its memory is released when the arena is reset,
+ * so the list needs no `List_free`, which only releases the
+ * memory if the list is still the most recent allocation.
+ *
+ * This way, lists which are built and thrown away
+ * often never use `malloc(3)` or `free(3)`.
+ *
+ * This needs `arena.h` to be included.
+ *
+ * If an error occurs during allocation, the `error`
+ * field will be set to `1`.
+ *
+ * For example:
+ * ```
+ * ListType(MyCharList, char);
+ * MyCharList list;
+ * Arena arena;
+ *
+ * // ----
+ *
+ * // For each request
+ * List_init_arena(list, 64 * sizeof(char), &arena);
+ *
+ * // Check for errors
+ * if (list.error) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ *
+ * Arena_reset(&arena);
+ * ```
+ *
+ * @param R The list to initialize.
+ * @param S The quantity of bytes to be allocated
+ *          to the list initially.
+ * @param A A pointer to the arena, which must outlive the list.
+ */
+#define List_init_arena(R, S, A) \
+    List_init_allocator(R, S, Arena_allocator(A))
+
 /**
  * Frees the underlying allocated memory a list owns,
  * setting the `buf` field to NULL afterwards.
@@ -149,14 +292,22 @@
  *
  * @param R The list to free memory for.
  */
-#define List_free(R) {            \
-    COOL_LIST_FUNC_FREE((R).buf); \
-    (R).buf = NULL;               \
+#define List_free(R) {                            \
+    if ((R)._allocator != NULL) {                 \
+        Allocator_free((R)._allocator, (R).buf,   \
+            (R)._alloc_size);                     \
+    } else {                                      \
+        COOL_LIST_FUNC_FREE((R).buf);             \
+    }                                             \
+    (R).buf = NULL;                               \
 }
 
 /**
  * Pushes a value onto the end of the list.
  *
+ * If the list is full, its memory is doubled
+ * (or grown to fit the value, if that is larger).
+ *
  * If an error occurs during pushing, the `error`
  * field will be set to `1`.
  *
@@ -183,20 +334,44 @@
  */
 #define List_push(R, V) {                          \
     (R).error = 0;                                 \
-    if ((R).size >= (R)._alloc_size - 1) {         \
-        void *_list_temp = COOL_LIST_FUNC_REALLOC( \
-            (R).buf, (R)._alloc_size << 1          \
-        );                                         \
+    COOL_LIST_STAT(R, pushes, 1);                  \
+    if (((R).size + 1) * sizeof(*(R).buf)          \
+        > (R)._alloc_size) {                       \
+        size_t _list_size = (R)._alloc_size << 1;  \
+        if (_list_size < ((R).size + 1)            \
+            * sizeof(*(R).buf)) {                  \
+            _list_size = ((R).size + 1)            \
+                * sizeof(*(R).buf);                \
+        }                                          \
+        uintptr_t _list_old = (uintptr_t) (R).buf; \
+        (void) _list_old;                          \
+        COOL_TRACE_BEGIN("List_push realloc");     \
+        void *_list_temp = (R)._allocator          \
+            ? Allocator_realloc((R)._allocator,    \
+                (R).buf, (R)._alloc_size,          \
+                _list_size)                        \
+            : COOL_LIST_FUNC_REALLOC(              \
+                (R).buf, _list_size);              \
+        COOL_TRACE_END("List_push realloc");       \
         if (_list_temp == NULL) {                  \
             (R).error = 1;                         \
         } else {                                   \
+            COOL_TRACE_COUNTER("List capacity",    \
+                _list_size);                       \
+            COOL_LIST_STAT(R, reallocs, 1);        \
+            COOL_LIST_STAT(R, copied,              \
+                (_list_old != (uintptr_t)          \
+                    _list_temp)                    \
+                    ? (R).size * sizeof(*(R).buf)  \
+                    : 0);                          \
             (R).buf = _list_temp;                  \
-            (R)._alloc_size <<= 1;                 \
+            (R)._alloc_size = _list_size;          \
             (R).buf[(R).size++] = V;               \
         }                                          \
     } else {                                       \
         (R).buf[(R).size++] = V;                   \
     }                                              \
+    _List_stats_peak(R);                           \
 }
 
 /**
@@ -292,7 +467,8 @@
         (R).size, (R)._alloc_size                               \
     );                                                          \
     if ((R).buf != NULL) {                                      \
-        for (size_t i = 0; i < (R)._alloc_size; i++) {          \
+        for (size_t i = 0;                                      \
+            i < (R)._alloc_size / sizeof(*(R).buf); i++) {      \
             if ((i + 1) % 20 == 0) printf("%#x\n", (R).buf[i]); \
             else printf("%#x ", (R).buf[i]);                    \
         }                                                       \
@@ -302,4 +478,76 @@
     }                                                           \
 }
 
+#ifdef COOL_STATS
+
+#define _List_stats_init(R) \
+    memset(&(R)._stats, 0, sizeof((R)._stats))
+
+#define _List_stats_peak(R)                   \
+    (((R).size > (R)._stats.peak)             \
+        ? (void) ((R)._stats.peak = (R).size) \
+        : (void) 0)
+
+/**
+ * Gets the statistics of a list (see `ListStats`).
+ *
+ * Counting is compiled in only if `COOL_STATS` is defined,
+ * and costs nothing otherwise. The counters are kept until
+ * the list is initialized again.
+ *
+ * For example:
+ * ```
+ * ListType(MyCharList, char);
+ * MyCharList list;
+ *
+ * // ----
+ *
+ * ListStats stats = List_stats(list);
+ * printf("%zu reallocs\n", stats.reallocs);
+ *
+ * // ----
+ * ```
+ *
+ * @param R The list to get the statistics of.
+ * @return The statistics.
+ */
+#define List_stats(R) ((R)._stats)
+
+/**
+ * Writes the statistics of a list (see `List_stats`),
+ * along with its current size and capacity, to a
+ * stream as a single line JSON object.
+ *
+ * For example:
+ * ```
+ * ListType(MyCharList, char);
+ * MyCharList list;
+ *
+ * // ----
+ *
+ * List_stats_json(list, stderr);
+ *
+ * // ----
+ * ```
+ *
+ * @param R The list to write the statistics of.
+ * @param F The stream to write to.
+ */
+#define List_stats_json(R, F) {                                    \
+    fprintf(                                                       \
+        (F),                                                       \
+        "{\"pushes\": %zu, \"reallocs\": %zu, \"copied\": %zu, "   \
+        "\"peak\": %zu, \"size\": %zu, \"capacity\": %zu}\n",      \
+        (R)._stats.pushes, (R)._stats.reallocs, (R)._stats.copied, \
+        (R)._stats.peak, (R).size, (R)._alloc_size                 \
+    );                                                             \
+}
+
+#else
+
+#define _List_stats_init(R) ((void) 0)
+#define _List_stats_peak(R) ((void) 0)
+
+#endif // COOL_STATS
+
 #endif // _COOL_LIST_H
@@ -0,0 +1,326 @@
+#ifndef _COOL_POOL_H
+#define _COOL_POOL_H
+
+#include <stdint.h>
+
+#include "arena.h"
+
+typedef struct PoolSlot {
+    struct PoolSlot *_next;
+} PoolSlot;
+
+typedef struct Pool {
+    Arena *_arena;
+    PoolSlot *_free;
+    char *_ptr;
+    char *_end;
+    uintptr_t _slot_size;
+    uintptr_t _chunk_size;
+    uintptr_t _in_use;
+    uintptr_t _capacity;
+} Pool;
+
+/**
+ * Initializes a `Pool` struct, which hands out fixed-size
+ * slots carved out of an arena, and keeps freed slots on
+ * a free list to be handed out again.
+ *
+ * This way, objects of the same size (such as the nodes
+ * of a tree) can be freed individually, which an arena
+ * alone can't do.
+ *
+ * The arena is not owned by the pool, and the pool
+ * must be reset with `Pool_reset` whenever the arena
+ * is reset. The pool needs no freeing of its own.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ * Pool pool;
+ *
+ * Arena_init(&arena);
+ * Pool_init(&pool, &arena, 48);
+ *
+ * // ----
+ * ```
+ *
+ * @param pool The pool to initialize.
+ * @param arena The arena to carve slots out of.
+ * @param slot_size The size of each slot in bytes, which is
+ *                  rounded up to a multiple of `sizeof(uintptr_t)`.
+ */
+void Pool_init(Pool *pool, Arena *arena, uintptr_t slot_size);
+
+/**
+ * Carves a new slot out of the arena.
+ *
+ * This is the out of line slow path of `Pool_alloc`,
+ * and is only called when the free list is empty.
+ * It should not be called directly.
+ *
+ * @param pool The pool to allocate a slot in.
+ * @return A pointer on success, NULL otherwise.
+ */
+COOL_ARENA_COLD void *_Pool_refill(Pool *pool);
+
+/**
+ * Allocates a slot in the pool.
+ *
+ * If a slot has been freed, this only pops it off of the
+ * free list. Otherwise, a new slot is carved out of the arena.
+ *
+ * Slots are aligned to the largest power of two which divides
+ * the slot size, up to `_Alignof(max_align_t)`, so a slot sized
+ * for a type is aligned for it. Slots are not zeroed.
+ *
+ * For example:
+ * ```
+ * Pool pool;
+ *
+ * // ----
+ *
+ * char *slot = Pool_alloc(&pool);
+ *
+ * // Check for failure
+ * if (slot == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param pool The pool to allocate a slot in.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *Pool_alloc(Pool *pool) {
+    PoolSlot *slot = pool->_free;
+
+    if (COOL_ARENA_LIKELY(slot != NULL)) {
+        pool->_free = slot->_next;
+        pool->_in_use++;
+        return slot;
+    }
+
+    return _Pool_refill(pool);
+}
+
+/**
+ * Frees a slot, so that it can be allocated again.
+ *
+ * For example:
+ * ```
+ * Pool pool;
+ *
+ * // ----
+ *
+ * char *slot = Pool_alloc(&pool);
+ *
+ * // ----
+ *
+ * Pool_free(&pool, slot);
+ * ```
+ *
+ * @param pool The pool the slot was allocated in.
+ * @param ptr The slot, or NULL to do nothing.
+ */
+static inline void Pool_free(Pool *pool, void *ptr) {
+    PoolSlot *slot = (PoolSlot *) ptr;
+
+    if (slot == NULL) return;
+
+    slot->_next = pool->_free;
+    pool->_free = slot;
+    pool->_in_use--;
+}
+
+/**
+ * Forgets every slot of the pool, which must be
+ * done whenever its arena is reset or freed.
+ *
+ * For example:
+ * ```
+ * Arena arena;
+ * Pool pool;
+ *
+ * // ----
+ *
+ * Arena_reset(&arena);
+ * Pool_reset(&pool);
+ *
+ * // ----
+ * ```
+ *
+ * @param pool The pool to reset.
+ */
+void Pool_reset(Pool *pool);
+
+/**
+ * Gets the quantity of slots of the pool which
+ * are currently allocated.
+ *
+ * @param pool The pool to get the quantity of slots of.
+ * @return The quantity of slots in use.
+ */
+uintptr_t Pool_in_use(Pool *pool);
+
+/**
+ * Gets the quantity of slots which have been carved out of
+ * the arena since the pool was initialized or reset, which
+ * is the most slots the pool has had in use at once.
+ *
+ * Together with `Pool_in_use`, this gives the
+ * occupancy of the pool.
+ *
+ * For example:
+ * ```
+ * Pool pool;
+ *
+ * // ----
+ *
+ * printf(
+ *     "%lu of %lu slots in use\n",
+ *     Pool_in_use(&pool), Pool_capacity(&pool)
+ * );
+ * ```
+ *
+ * @param pool The pool to get the quantity of slots of.
+ * @return The quantity of slots carved out.
+ */
+uintptr_t Pool_capacity(Pool *pool);
+
+/**
+ * Declares a pool type for a given type, along with
+ * functions which allocate and free that type, with
+ * the slot size fixed at compile time.
+ *
+ * This must be used at file scope.
+ *
+ * For example:
+ * ```
+ * typedef struct Node {
+ *     struct Node *next;
+ *     int value;
+ * } Node;
+ *
+ * // Declare the type, along with NodePool_init, NodePool_alloc,
+ * // NodePool_free, NodePool_reset, NodePool_in_use
+ * // and NodePool_capacity
+ * PoolType(NodePool, Node);
+ *
+ * // ----
+ *
+ * NodePool pool;
+ * NodePool_init(&pool, &arena);
+ *
+ * Node *node = NodePool_alloc(&pool);
+ *
+ * // ----
+ *
+ * NodePool_free(&pool, node);
+ * ```
+ *
+ * @param N The name of the type.
+ * @param T The type which this pool should hold.
+ */
+#define PoolType(N, T)                                          \
+    typedef struct N {                                          \
+        Pool _pool;                                             \
+    } N;                                                        \
+    static inline void N##_init(N *pool, Arena *arena) {        \
+        Pool_init(&pool->_pool, arena, sizeof(T));              \
+    }                                                           \
+    static inline T *N##_alloc(N *pool) {                       \
+        return (T *) Pool_alloc(&pool->_pool);                  \
+    }                                                           \
+    static inline void N##_free(N *pool, T *ptr) {              \
+        Pool_free(&pool->_pool, ptr);                           \
+    }                                                           \
+    static inline void N##_reset(N *pool) {                     \
+        Pool_reset(&pool->_pool);                               \
+    }                                                           \
+    static inline uintptr_t N##_in_use(N *pool) {               \
+        return Pool_in_use(&pool->_pool);                       \
+    }                                                           \
+    static inline uintptr_t N##_capacity(N *pool) {             \
+        return Pool_capacity(&pool->_pool);                     \
+    }                                                           \
+    typedef struct N N
+
+#ifdef COOL_POOL_IMPL
+
+/**
+ * The quantity of bytes carved out of the
+ * arena at a time, to be split into slots.
+ *
+ * Larger chunks mean fewer trips to the arena, but
+ * this should be well below the region size of the arena
+ * (`COOL_ARENA_DEF_SIZE`), so that chunks do not end up
+ * in blocks of their own.
+ */
+#ifndef COOL_POOL_CHUNK_SIZE
+#define COOL_POOL_CHUNK_SIZE 2048
+#endif
+
+void Pool_init(Pool *pool, Arena *arena, uintptr_t slot_size) {
+    slot_size = COOL_ARENA_ROUND(slot_size);
+
+    // Each free slot holds the link of the free list
+    if (slot_size < sizeof(PoolSlot)) slot_size = sizeof(PoolSlot);
+
+    pool->_arena = arena;
+    pool->_slot_size = slot_size;
+
+    // Fit a whole number of slots in each chunk,
+    // and at least one
+    pool->_chunk_size = (slot_size < COOL_POOL_CHUNK_SIZE)
+        ? COOL_POOL_CHUNK_SIZE - COOL_POOL_CHUNK_SIZE % slot_size
+        : slot_size;
+
+    Pool_reset(pool);
+}
+
+void *_Pool_refill(Pool *pool) {
+    char *slot;
+
+    // Carve slots out of the current chunk as they're needed,
+    // rather than threading the whole chunk onto the free list
+    if (pool->_ptr == pool->_end) {
+        pool->_ptr = (char *) Arena_alloc_aligned(
+            pool->_arena, pool->_chunk_size, _Alignof(max_align_t)
+        );
+
+        if (pool->_ptr == NULL) {
+            pool->_end = NULL;
+            return NULL;
+        }
+
+        pool->_end = pool->_ptr + pool->_chunk_size;
+    }
+
+    slot = pool->_ptr;
+    pool->_ptr += pool->_slot_size;
+    pool->_in_use++;
+    pool->_capacity++;
+
+    return slot;
+}
+
+void Pool_reset(Pool *pool) {
+    pool->_free = NULL;
+    pool->_ptr = NULL;
+    pool->_end = NULL;
+    pool->_in_use = 0;
+    pool->_capacity = 0;
+}
+
+uintptr_t Pool_in_use(Pool *pool) {
+    return pool->_in_use;
+}
+
+uintptr_t Pool_capacity(Pool *pool) {
+    return pool->_capacity;
+}
+
+#endif // COOL_POOL_IMPL
+
+#endif // _COOL_POOL_H
@@ -0,0 +1,520 @@
+#ifndef _COOL_SLAB_H
+#define _COOL_SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocator.h"
+
+/**
+ * Hints used to keep the fast paths of `Slab_alloc`
+ * and `Slab_free` small, and the slow paths out of line.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define COOL_SLAB_LIKELY(X) __builtin_expect(!!(X), 1)
+#define COOL_SLAB_COLD __attribute__((cold, noinline))
+#else
+#define COOL_SLAB_LIKELY(X) (X)
+#define COOL_SLAB_COLD
+#endif
+
+/**
+ * The size of each slab, which must be a power of two.
+ *
+ * Slabs are aligned to their size, so that the slab
+ * (and size class) of an object can be found by masking
+ * its address.
+ */
+#ifndef COOL_SLAB_SIZE
+#define COOL_SLAB_SIZE 64 * 1024
+#endif
+
+/**
+ * The largest size `Slab_alloc` can allocate.
+ */
+#define COOL_SLAB_MAX_SIZE 512
+
+/**
+ * The quantity of size classes.
+ */
+#define COOL_SLAB_CLASSES 16
+
+typedef struct SlabObject {
+    struct SlabObject *_next;
+} SlabObject;
+
+typedef struct SlabHeader {
+    struct SlabHeader *_next_region;
+    uint32_t _class;
+} SlabHeader;
+
+typedef struct SlabCache {
+    SlabObject *_free;
+    uint32_t _count;
+
+    // 0 until the thread is registered, so that
+    // the first free takes the slow path
+    uint32_t _limit;
+} SlabCache;
+
+/**
+ * The size class of each size, indexed by
+ * the size in units of 16 bytes, rounded up.
+ */
+static const uint8_t _slab_class_of[COOL_SLAB_MAX_SIZE / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15
+};
+
+/**
+ * The calling thread's cache of free objects of each size class.
+ *
+ * This is used by `Slab_alloc` and `Slab_free`,
+ * and should not be used directly.
+ */
+extern _Thread_local SlabCache _slab_cache[COOL_SLAB_CLASSES];
+
+/**
+ * Takes a batch of objects of a size class from the
+ * central free list, or carves them out of a slab,
+ * and allocates one of them.
+ *
+ * This is the out of line slow path of `Slab_alloc`,
+ * and is only called when the calling thread's cache
+ * is empty. It should not be called directly.
+ *
+ * @param class The size class to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+COOL_SLAB_COLD void *_Slab_refill(int class);
+
+/**
+ * Moves a batch of objects of a size class from the
+ * calling thread's cache to the central free list.
+ *
+ * This is the out of line slow path of `Slab_free`,
+ * and is only called when the calling thread's cache
+ * is full. It should not be called directly.
+ *
+ * @param class The size class to move objects of.
+ */
+COOL_SLAB_COLD void _Slab_flush(int class);
+
+/**
+ * Allocates a small object, of at most `COOL_SLAB_MAX_SIZE`
+ * bytes, from the slab allocator.
+ *
+ * The size is rounded up to one of 16 size classes, from
+ * 16 to 512 bytes. Each size class has slabs of its own,
+ * so objects of the same size are packed together.
+ *
+ * Each thread keeps a cache of free objects of each size class,
+ * so this is usually only a pop off of a thread-local list.
+ * When the cache is empty, a batch of objects is taken from
+ * a central free list (or carved out of a slab) at once.
+ *
+ * Objects are aligned to 16 bytes, and are not zeroed.
+ * Memory is never returned to the system.
+ *
+ * This is thread-safe.
+ *
+ * For example:
+ * ```
+ * char *mem = Slab_alloc(100);
+ *
+ * // Check for failure
+ * if (mem == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ *
+ * Slab_free(mem);
+ * ```
+ *
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise (including when
+ *         size is 0 or larger than `COOL_SLAB_MAX_SIZE`).
+ */
+static inline void *Slab_alloc(size_t size) {
+    SlabCache *cache;
+    SlabObject *object;
+    int class;
+
+    if (size - 1 >= COOL_SLAB_MAX_SIZE) return NULL;
+
+    class = _slab_class_of[(size + 15) >> 4];
+    cache = &_slab_cache[class];
+    object = cache->_free;
+
+    if (COOL_SLAB_LIKELY(object != NULL)) {
+        cache->_free = object->_next;
+        cache->_count--;
+        return object;
+    }
+
+    return _Slab_refill(class);
+}
+
+/**
+ * Frees an object allocated with `Slab_alloc`,
+ * from any thread.
+ *
+ * The size class of the object is found from the header
+ * of its slab, which is found by masking its address.
+ *
+ * The object is kept in the calling thread's cache. When
+ * the cache is full, a batch of objects is moved to the
+ * central free list at once.
+ *
+ * @param ptr The object, or NULL to do nothing.
+ */
+static inline void Slab_free(void *ptr) {
+    SlabHeader *slab = (SlabHeader *) (
+        (uintptr_t) ptr & ~(uintptr_t) (COOL_SLAB_SIZE - 1)
+    );
+    SlabObject *object = (SlabObject *) ptr;
+    SlabCache *cache;
+
+    if (ptr == NULL) return;
+
+    cache = &_slab_cache[slab->_class];
+    object->_next = cache->_free;
+    cache->_free = object;
+
+    if (COOL_SLAB_LIKELY(++cache->_count <= cache->_limit)) return;
+
+    _Slab_flush((int) slab->_class);
+}
+
+/**
+ * Gets an allocator (see `Allocator`) which allocates
+ * small objects with the slab allocator, and larger
+ * ones with `malloc(3)`.
+ *
+ * For example:
+ * ```
+ * ListType(MyCharList, char);
+ * MyCharList list;
+ *
+ * List_init_allocator(list, 64, Slab_allocator());
+ * ```
+ *
+ * @return The allocator.
+ */
+const Allocator *Slab_allocator(void);
+
+#ifdef COOL_SLAB_IMPL
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The quantity of objects moved between a thread's
+ * cache and the central free list at once.
+ */
+#ifndef COOL_SLAB_BATCH
+#define COOL_SLAB_BATCH 32
+#endif
+
+/**
+ * The most objects of each size class each
+ * thread's cache holds before moving a batch
+ * to the central free list.
+ */
+#ifndef COOL_SLAB_CACHE_MAX
+#define COOL_SLAB_CACHE_MAX 2 * COOL_SLAB_BATCH
+#endif
+
+/**
+ * The size of each region, which slabs are carved out of.
+ * This must be a multiple of `COOL_SLAB_SIZE`.
+ */
+#ifndef COOL_SLAB_REGION_SIZE
+#define COOL_SLAB_REGION_SIZE 16 * COOL_SLAB_SIZE
+#endif
+
+/**
+ * The size of the header at the start of each slab,
+ * which keeps the objects after it aligned.
+ */
+#define COOL_SLAB_HEADER_SIZE 64
+
+/**
+ * The underlying function for allocating regions.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `aligned_alloc(3)`,
+ * and must be thread-safe.
+ *
+ * This function must also return a valid pointer
+ * on success, and NULL on failure.
+ */
+#ifndef COOL_SLAB_FUNC_ALLOC
+#define COOL_SLAB_FUNC_ALLOC aligned_alloc
+#endif
+
+typedef struct SlabClass {
+    _Alignas(64) pthread_mutex_t _lock;
+
+    // Objects freed by threads, in batches
+    SlabObject *_free;
+
+    // The free memory of the current slab
+    char *_ptr;
+    char *_end;
+} SlabClass;
+
+static const uint16_t _slab_sizes[COOL_SLAB_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+_Thread_local SlabCache _slab_cache[COOL_SLAB_CLASSES];
+
+static SlabClass _slab_central[COOL_SLAB_CLASSES];
+static pthread_once_t _slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _slab_key;
+static int _slab_key_ok;
+
+// The free memory of the current region, and the first slab of
+// every region, linked through `_next_region`
+static pthread_mutex_t _slab_region_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *_slab_region_ptr;
+static char *_slab_region_end;
+static SlabHeader *_slab_regions;
+
+/**
+ * Moves every object in the cache of an
+ * exiting thread to the central free lists.
+ */
+static void _Slab_exit(void *value) {
+    SlabCache *cache;
+    SlabObject *tail;
+    int class;
+
+    (void) value;
+
+    for (class = 0; class < COOL_SLAB_CLASSES; class++) {
+        cache = &_slab_cache[class];
+        cache->_limit = 0;
+
+        if (cache->_free == NULL) continue;
+
+        for (tail = cache->_free; tail->_next != NULL; tail = tail->_next);
+
+        pthread_mutex_lock(&_slab_central[class]._lock);
+        tail->_next = _slab_central[class]._free;
+        _slab_central[class]._free = cache->_free;
+        pthread_mutex_unlock(&_slab_central[class]._lock);
+
+        cache->_free = NULL;
+        cache->_count = 0;
+    }
+}
+
+static void _Slab_init(void) {
+    for (int class = 0; class < COOL_SLAB_CLASSES; class++) {
+        pthread_mutex_init(&_slab_central[class]._lock, NULL);
+    }
+
+    _slab_key_ok = pthread_key_create(&_slab_key, _Slab_exit) == 0;
+}
+
+/**
+ * Registers the calling thread, so that its cache is
+ * flushed when it exits, and lets its cache fill up.
+ */
+static void _Slab_register(void) {
+    pthread_once(&_slab_once, _Slab_init);
+
+    // Without a destructor, objects are moved
+    // to the central free lists on every free
+    if (!_slab_key_ok || pthread_setspecific(_slab_key, _slab_cache) != 0) {
+        return;
+    }
+
+    for (int class = 0; class < COOL_SLAB_CLASSES; class++) {
+        _slab_cache[class]._limit = COOL_SLAB_CACHE_MAX;
+    }
+}
+
+/**
+ * Carves a new slab for a size class out of the current
+ * region, allocating a new region if needed.
+ *
+ * The lock of the size class must be held.
+ */
+static int _Slab_new(SlabClass *central, int class) {
+    SlabHeader *slab;
+
+    pthread_mutex_lock(&_slab_region_lock);
+
+    if (_slab_region_ptr == _slab_region_end) {
+        _slab_region_ptr = (char *) COOL_SLAB_FUNC_ALLOC(
+            COOL_SLAB_SIZE, COOL_SLAB_REGION_SIZE
+        );
+
+        if (_slab_region_ptr == NULL) {
+            _slab_region_end = NULL;
+            pthread_mutex_unlock(&_slab_region_lock);
+            return -1;
+        }
+
+        _slab_region_end = _slab_region_ptr + COOL_SLAB_REGION_SIZE;
+
+        // Record the region, so that it remains reachable
+        ((SlabHeader *) _slab_region_ptr)->_next_region = _slab_regions;
+        _slab_regions = (SlabHeader *) _slab_region_ptr;
+    }
+
+    slab = (SlabHeader *) _slab_region_ptr;
+    _slab_region_ptr += COOL_SLAB_SIZE;
+
+    pthread_mutex_unlock(&_slab_region_lock);
+
+    slab->_class = (uint32_t) class;
+    central->_ptr = (char *) slab + COOL_SLAB_HEADER_SIZE;
+    central->_end = (char *) slab + COOL_SLAB_SIZE;
+
+    return 0;
+}
+
+void *_Slab_refill(int class) {
+    SlabCache *cache = &_slab_cache[class];
+    SlabClass *central = &_slab_central[class];
+    uintptr_t size = _slab_sizes[class];
+    SlabObject *head = NULL;
+    SlabObject **tail = &head;
+    SlabObject *object;
+    uint32_t count = 0;
+
+    if (cache->_limit == 0) _Slab_register();
+
+    pthread_mutex_lock(&central->_lock);
+
+    // Take a batch of freed objects first
+    while (count < COOL_SLAB_BATCH && central->_free != NULL) {
+        object = central->_free;
+        central->_free = object->_next;
+
+        *tail = object;
+        tail = &object->_next;
+        count++;
+    }
+
+    // Then carve the rest out of slabs
+    while (count < COOL_SLAB_BATCH) {
+        if ((uintptr_t) (central->_end - central->_ptr) < size
+            && _Slab_new(central, class) != 0) {
+            break;
+        }
+
+        object = (SlabObject *) central->_ptr;
+        central->_ptr += size;
+
+        *tail = object;
+        tail = &object->_next;
+        count++;
+    }
+
+    pthread_mutex_unlock(&central->_lock);
+
+    *tail = NULL;
+    if (head == NULL) return NULL;
+
+    // Keep all but the first object
+    cache->_free = head->_next;
+    cache->_count = count - 1;
+
+    return head;
+}
+
+void _Slab_flush(int class) {
+    SlabCache *cache = &_slab_cache[class];
+    SlabClass *central = &_slab_central[class];
+    SlabObject *head = cache->_free;
+    SlabObject *tail = head;
+    uint32_t count = 1;
+
+    if (cache->_limit == 0) {
+        _Slab_register();
+        if (cache->_count <= cache->_limit) return;
+    }
+
+    // Split a batch off of the cache, or the whole cache
+    // if the thread couldn't be registered
+    if (cache->_limit != 0) {
+        for (; count < COOL_SLAB_BATCH; count++) tail = tail->_next;
+    } else {
+        for (; tail->_next != NULL; count++) tail = tail->_next;
+    }
+
+    cache->_free = tail->_next;
+    cache->_count -= count;
+
+    pthread_mutex_lock(&central->_lock);
+    tail->_next = central->_free;
+    central->_free = head;
+    pthread_mutex_unlock(&central->_lock);
+}
+
+static void *_Slab_allocator_alloc(void *ctx, size_t size) {
+    (void) ctx;
+
+    if (size > COOL_SLAB_MAX_SIZE) return malloc(size);
+    return Slab_alloc(size);
+}
+
+static void *_Slab_allocator_realloc(
+    void *ctx, void *ptr, size_t old_size, size_t new_size
+) {
+    void *mem;
+
+    (void) ctx;
+
+    if (ptr == NULL) return _Slab_allocator_alloc(NULL, new_size);
+
+    // Both sizes are large, so realloc(3) can be used
+    if (old_size > COOL_SLAB_MAX_SIZE && new_size > COOL_SLAB_MAX_SIZE) {
+        return realloc(ptr, new_size);
+    }
+
+    mem = _Slab_allocator_alloc(NULL, new_size);
+    if (mem == NULL) return NULL;
+
+    memcpy(mem, ptr, (old_size < new_size) ? old_size : new_size);
+
+    if (old_size > COOL_SLAB_MAX_SIZE) {
+        free(ptr);
+    } else {
+        Slab_free(ptr);
+    }
+
+    return mem;
+}
+
+static void _Slab_allocator_free(void *ctx, void *ptr, size_t size) {
+    (void) ctx;
+
+    if (size > COOL_SLAB_MAX_SIZE) {
+        free(ptr);
+    } else {
+        Slab_free(ptr);
+    }
+}
+
+const Allocator *Slab_allocator(void) {
+    static const Allocator allocator = {
+        _Slab_allocator_alloc,
+        _Slab_allocator_realloc,
+        _Slab_allocator_free,
+        NULL
+    };
+
+    return &allocator;
+}
+
+#endif // COOL_SLAB_IMPL
+
+#endif // _COOL_SLAB_H
@@ -0,0 +1,408 @@
+#ifndef _COOL_TLAB_H
+#define _COOL_TLAB_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic_arena.h"
+
+/**
+ * The size of a cache line, which each thread's
+ * allocation buffer is aligned and padded to,
+ * so that no two threads write to the same line.
+ */
+#ifndef COOL_TLAB_CACHE_LINE
+#define COOL_TLAB_CACHE_LINE 64
+#endif
+
+typedef struct Tlab {
+    _Alignas(COOL_TLAB_CACHE_LINE) char *_ptr;
+    char *_end;
+
+    // The generation of the parent the chunk was carved in
+    uintptr_t _generation;
+
+    struct Tlab *_next;
+    _Atomic int _in_use;
+} Tlab;
+
+typedef struct TlabArena {
+    AtomicArena *_parent;
+    uintptr_t _chunk_size;
+    uintptr_t _id;
+    pthread_key_t _key;
+    _Atomic(Tlab *) _tlabs;
+} TlabArena;
+
+/**
+ * The TLAB of the calling thread for the `TlabArena` it last
+ * allocated from, so that the fast path of `TlabArena_alloc`
+ * doesn't need to call `pthread_getspecific(3)`.
+ *
+ * Arenas are identified by an id which is never reused,
+ * so a stale entry never matches a later arena.
+ */
+typedef struct TlabCache {
+    uintptr_t _id;
+    Tlab *_tlab;
+} TlabCache;
+
+extern _Thread_local TlabCache _tlab_cache;
+
+/**
+ * Initializes a `TlabArena` struct, which hands each
+ * thread its own allocation buffer (a TLAB), carved in
+ * large chunks out of a shared parent `AtomicArena`.
+ *
+ * Allocating from a TLAB needs no atomics, and no cache
+ * lines are shared between threads. Each thread's TLAB is
+ * set up on its first allocation, and is released for reuse
+ * by other threads when the thread exits.
+ *
+ * The parent arena is not owned by the `TlabArena`, and
+ * must outlive it. It may also be allocated from directly,
+ * and reset directly, in which case every thread's TLAB is
+ * discarded on its next allocation, as its chunk has been
+ * reset along with the parent.
+ *
+ * For example:
+ * ```
+ * AtomicArena parent;
+ * TlabArena arena;
+ *
+ * AtomicArena_init(&parent);
+ *
+ * if (TlabArena_init(&arena, &parent, 0) != 0) {
+ *     perror("pthread_key_create");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to initialize.
+ * @param parent The arena to carve chunks out of.
+ * @param chunk_size The quantity of bytes to carve out for
+ *                   each chunk, or 0 for `COOL_TLAB_CHUNK_SIZE`.
+ * @return 0 on success, an error number otherwise.
+ */
+int TlabArena_init(TlabArena *arena, AtomicArena *parent, uintptr_t chunk_size);
+
+/**
+ * Sets up the calling thread's TLAB if needed, carves a
+ * new chunk out of the parent, then allocates a given
+ * quantity of memory within it.
+ *
+ * This is the out of line slow path of `TlabArena_alloc`,
+ * and is only called when the calling thread's TLAB does not
+ * have enough free memory. It should not be called directly.
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate, which must
+ *             be a multiple of `sizeof(uintptr_t)`.
+ * @return A pointer on success, NULL otherwise.
+ */
+COOL_ATOMIC_ARENA_COLD void *_TlabArena_refill(
+    TlabArena *arena, uintptr_t size
+);
+
+/**
+ * Allocates a given quantity of memory within
+ * the calling thread's TLAB.
+ *
+ * The size is rounded up to a multiple of `sizeof(uintptr_t)`.
+ *
+ * If the TLAB has enough free memory, and the parent has not
+ * been reset since its chunk was carved out, this is only a
+ * few comparisons and an increment of a thread-local bump
+ * pointer. Otherwise, a new chunk is carved out of the parent.
+ * Allocations larger than a quarter of a chunk are
+ * allocated from the parent arena directly.
+ *
+ * For example:
+ * ```
+ * TlabArena arena;
+ *
+ * // ----
+ *
+ * // From any thread
+ * char *mem = TlabArena_alloc(&arena, 1024);
+ *
+ * // Check for failure
+ * if (mem == NULL) {
+ *     perror("malloc");
+ * }
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to allocate memory in.
+ * @param size The quantity of bytes to allocate.
+ * @return A pointer on success, NULL otherwise.
+ */
+static inline void *TlabArena_alloc(TlabArena *arena, uintptr_t size) {
+    Tlab *tlab = (_tlab_cache._id == arena->_id) ? _tlab_cache._tlab : NULL;
+    char *mem;
+
+    // Round size up to a multiple of the word size
+    size = (size + sizeof(uintptr_t) - 1) & ~(uintptr_t) (sizeof(uintptr_t) - 1);
+
+    // A size of 0 (including one which overflowed while
+    // rounding) wraps around here, so takes the slow path
+    if (COOL_ATOMIC_ARENA_LIKELY(
+        tlab != NULL
+        && size - 1 < (uintptr_t) tlab->_end - (uintptr_t) tlab->_ptr
+        && tlab->_generation == atomic_load_explicit(
+            &arena->_parent->_generation, memory_order_relaxed
+        )
+    )) {
+        mem = tlab->_ptr;
+        tlab->_ptr = mem + size;
+        return mem;
+    }
+
+    return _TlabArena_refill(arena, size);
+}
+
+/**
+ * Resets the arena, along with its parent.
+ *
+ * Every thread's TLAB is emptied, and then the parent
+ * is reset with `AtomicArena_reset`, so that all memory
+ * allocated by every thread is released at once.
+ *
+ * Resetting the parent directly has the same effect.
+ *
+ * This must not be called while other
+ * threads are using the arena or its parent.
+ *
+ * For example:
+ * ```
+ * TlabArena arena;
+ *
+ * // ----
+ *
+ * TlabArena_reset(&arena);
+ *
+ * // ----
+ * ```
+ *
+ * @param arena The arena to reset.
+ */
+void TlabArena_reset(TlabArena *arena);
+
+/**
+ * Frees the arena.
+ *
+ * Every thread's TLAB is freed, but the parent is not.
+ * Memory allocated from the arena remains valid
+ * until the parent is reset or freed.
+ *
+ * This must not be called while other
+ * threads are using the arena.
+ *
+ * For example:
+ * ```
+ * AtomicArena parent;
+ * TlabArena arena;
+ *
+ * // ----
+ *
+ * TlabArena_free(&arena);
+ * AtomicArena_free(&parent);
+ * ```
+ */
+void TlabArena_free(TlabArena *arena);
+
+#ifdef COOL_TLAB_IMPL
+
+/**
+ * The default quantity of bytes each TLAB carves
+ * out of the parent arena at a time.
+ *
+ * This should be well below the region size of the parent
+ * (`COOL_ATOMIC_ARENA_DEF_SIZE`), so that chunks do not
+ * end up in regions of their own.
+ */
+#ifndef COOL_TLAB_CHUNK_SIZE
+#define COOL_TLAB_CHUNK_SIZE 16 * 1024
+#endif
+
+/**
+ * The underlying function for allocating
+ * memory for each thread's TLAB.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `aligned_alloc(3)`,
+ * and must be thread-safe.
+ *
+ * This function must also return a valid pointer
+ * on success, and NULL on failure.
+ */
+#ifndef COOL_TLAB_FUNC_ALLOC
+#include <stdlib.h>
+#define COOL_TLAB_FUNC_ALLOC aligned_alloc
+#endif
+
+/**
+ * The underlying function for freeing
+ * memory for each thread's TLAB.
+ *
+ * This function can be changed, but it must have
+ * the same function signature as `free(3)`
+ */
+#ifndef COOL_TLAB_FUNC_FREE
+#include <stdlib.h>
+#define COOL_TLAB_FUNC_FREE free
+#endif
+
+_Thread_local TlabCache _tlab_cache;
+
+// The id of the next arena, starting from 1,
+// as 0 is the id of an empty cache
+static _Atomic uintptr_t _tlab_next_id = 1;
+
+/**
+ * Releases a thread's TLAB when the thread exits, so that
+ * it can be reused by another thread. TLABs are only freed
+ * by `TlabArena_free`.
+ */
+static void _TlabArena_release(void *value) {
+    Tlab *tlab = (Tlab *) value;
+
+    tlab->_ptr = NULL;
+    tlab->_end = NULL;
+    atomic_store_explicit(&tlab->_in_use, 0, memory_order_release);
+}
+
+int TlabArena_init(TlabArena *arena, AtomicArena *parent, uintptr_t chunk_size) {
+    if (chunk_size == 0) chunk_size = COOL_TLAB_CHUNK_SIZE;
+
+    arena->_parent = parent;
+    arena->_chunk_size = chunk_size;
+    arena->_id = atomic_fetch_add(&_tlab_next_id, 1);
+    atomic_init(&arena->_tlabs, NULL);
+
+    return pthread_key_create(&arena->_key, _TlabArena_release);
+}
+
+/**
+ * Gets a TLAB for the calling thread, either one released
+ * by an exited thread, or a newly allocated one.
+ */
+static Tlab *_TlabArena_acquire(TlabArena *arena) {
+    Tlab *tlab = atomic_load_explicit(&arena->_tlabs, memory_order_acquire);
+    Tlab *head;
+    int in_use;
+
+    // Try reusing a released TLAB
+    for (; tlab != NULL; tlab = tlab->_next) {
+        in_use = 0;
+
+        if (atomic_compare_exchange_strong_explicit(
+            &tlab->_in_use, &in_use, 1,
+            memory_order_acquire, memory_order_relaxed
+        )) {
+            break;
+        }
+    }
+
+    if (tlab == NULL) {
+        tlab = (Tlab *) COOL_TLAB_FUNC_ALLOC(_Alignof(Tlab), sizeof(Tlab));
+        if (tlab == NULL) return NULL;
+
+        tlab->_ptr = NULL;
+        tlab->_end = NULL;
+        tlab->_generation = 0;
+        atomic_init(&tlab->_in_use, 1);
+
+        // Record the TLAB, so that it can be reset and freed
+        head = atomic_load_explicit(&arena->_tlabs, memory_order_relaxed);
+
+        do {
+            tlab->_next = head;
+        } while (!atomic_compare_exchange_weak_explicit(
+            &arena->_tlabs, &head, tlab,
+            memory_order_release, memory_order_relaxed
+        ));
+    }
+
+    if (pthread_setspecific(arena->_key, tlab) != 0) {
+        _TlabArena_release(tlab);
+        return NULL;
+    }
+
+    return tlab;
+}
+
+void *_TlabArena_refill(TlabArena *arena, uintptr_t size) {
+    Tlab *tlab = (Tlab *) pthread_getspecific(arena->_key);
+    uintptr_t generation;
+    char *chunk;
+
+    // If size is 0, do nothing
+    if (size == 0) return NULL;
+
+    // Large allocations would waste most of a chunk
+    if (size > arena->_chunk_size / 4) {
+        return AtomicArena_alloc(arena->_parent, size);
+    }
+
+    if (tlab == NULL) {
+        tlab = _TlabArena_acquire(arena);
+        if (tlab == NULL) return NULL;
+    }
+
+    _tlab_cache._id = arena->_id;
+    _tlab_cache._tlab = tlab;
+
+    // Carve a new chunk out of the parent. Whatever was left of
+    // the last one is abandoned, which is also what discards it
+    // if the parent has been reset since
+    generation = atomic_load_explicit(
+        &arena->_parent->_generation, memory_order_relaxed
+    );
+
+    chunk = (char *) AtomicArena_alloc(arena->_parent, arena->_chunk_size);
+    if (chunk == NULL) return NULL;
+
+    tlab->_ptr = chunk + size;
+    tlab->_end = chunk + arena->_chunk_size;
+    tlab->_generation = generation;
+
+    return chunk;
+}
+
+void TlabArena_reset(TlabArena *arena) {
+    Tlab *tlab = atomic_load(&arena->_tlabs);
+
+    // Empty every TLAB, as their chunks are about to be reset
+    for (; tlab != NULL; tlab = tlab->_next) {
+        tlab->_ptr = NULL;
+        tlab->_end = NULL;
+    }
+
+    AtomicArena_reset(arena->_parent);
+}
+
+void TlabArena_free(TlabArena *arena) {
+    Tlab *tlab = atomic_load(&arena->_tlabs);
+    Tlab *next;
+
+    // No destructors run after the key is deleted,
+    // so every TLAB can be freed here
+    pthread_key_delete(arena->_key);
+
+    while (tlab != NULL) {
+        next = tlab->_next;
+        COOL_TLAB_FUNC_FREE(tlab);
+        tlab = next;
+    }
+
+    atomic_store(&arena->_tlabs, NULL);
+}
+
+#endif // COOL_TLAB_IMPL
+
+#endif // _COOL_TLAB_H
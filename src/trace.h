@@ -0,0 +1,441 @@
+#ifndef _COOL_TRACE_H
+#define _COOL_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Records the start of a span on the calling thread's
+ * timeline, or does nothing unless `COOL_TRACE` is defined.
+ *
+ * Spans must be ended with `COOL_TRACE_END`, on the same thread
+ * and in reverse order of starting, and names must be string
+ * literals (or otherwise outlive the trace).
+ *
+ * For example:
+ * ```
+ * COOL_TRACE_BEGIN("parse");
+ *
+ * // ----
+ *
+ * COOL_TRACE_END("parse");
+ * ```
+ */
+#ifdef COOL_TRACE
+#define COOL_TRACE_BEGIN(N) _Trace_event('B', (N), 0)
+#define COOL_TRACE_END(N) _Trace_event('E', (N), 0)
+#define COOL_TRACE_COUNTER(N, V) _Trace_event('C', (N), (int64_t) (V))
+#else
+#define COOL_TRACE_BEGIN(N) ((void) 0)
+#define COOL_TRACE_END(N) ((void) 0)
+#define COOL_TRACE_COUNTER(N, V) ((void) 0)
+#endif
+
+/**
+ * Starts writing a trace of the spans and counters recorded by
+ * every thread to a stream, in the Chrome trace event format
+ * (a JSON array), which can be opened in `chrome://tracing`
+ * or https://ui.perfetto.dev.
+ *
+ * Each thread records events into a buffer of its own, without
+ * locks or system calls. The buffers are only written to the
+ * stream by `Trace_flush` and `Trace_stop`. If a thread's buffer
+ * fills up before it is flushed, further events are dropped,
+ * and the count is written as the "Trace dropped" counter.
+ *
+ * With `COOL_TRACE` defined, arenas record spans for allocating
+ * regions and large blocks and for `Arena_reset`, along with the
+ * "Arena used" counter at each reset, and lists record a span for
+ * each reallocation in `List_push`, along with the new capacity.
+ *
+ * This should not be called while other threads are recording.
+ *
+ * Tracing is only compiled in if `COOL_TRACE` is defined,
+ * in which case `COOL_TRACE_IMPL` must also be defined in
+ * one translation unit. Events are timed with a monotonic
+ * clock, which needs `_DEFAULT_SOURCE` (or an equivalent
+ * feature test macro) for `clock_gettime(2)`.
+ *
+ * For example:
+ * ```
+ * FILE *trace = fopen("trace.json", "w");
+ *
+ * if (trace == NULL || Trace_start(trace) != 0) {
+ *     perror("fopen");
+ * }
+ *
+ * // ----
+ *
+ * Trace_stop();
+ * fclose(trace);
+ * ```
+ *
+ * @param stream The stream to write to.
+ * @return 0 on success, -1 otherwise (including
+ *         when a trace is already being written).
+ */
+int Trace_start(FILE *stream);
+
+/**
+ * Writes every event recorded so far to the trace
+ * started by `Trace_start`, emptying the buffers.
+ *
+ * This may be called while other threads are recording,
+ * and should be called often enough to keep the buffers
+ * from filling up.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int Trace_flush(void);
+
+/**
+ * Stops recording events, flushes the remaining ones and
+ * ends the trace started by `Trace_start`. The stream is
+ * flushed, but not closed.
+ *
+ * Events recorded by other threads while this is
+ * being called may be discarded.
+ */
+void Trace_stop(void);
+
+/**
+ * Records an event in the calling thread's buffer,
+ * if a trace is being written.
+ *
+ * This is called by `COOL_TRACE_BEGIN`, `COOL_TRACE_END`
+ * and `COOL_TRACE_COUNTER`, and should not be called directly.
+ */
+void _Trace_event(int phase, const char *name, int64_t value);
+
+#ifdef COOL_TRACE_IMPL
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The quantity of events each thread's buffer holds,
+ * which must be a power of two.
+ */
+#ifndef COOL_TRACE_BUFFER_SIZE
+#define COOL_TRACE_BUFFER_SIZE 16384
+#endif
+
+/**
+ * The size of a cache line, which the positions the recording
+ * thread and `Trace_flush` update are kept apart by.
+ */
+#ifndef COOL_TRACE_CACHE_LINE
+#define COOL_TRACE_CACHE_LINE 64
+#endif
+
+typedef struct TraceEvent {
+    // Nanoseconds since `Trace_start`
+    uint64_t _time;
+
+    const char *_name;
+    int64_t _value;
+    uint32_t _thread;
+    char _phase;
+} TraceEvent;
+
+/**
+ * A ring of events, recorded by a single thread
+ * and emptied by `Trace_flush`.
+ */
+typedef struct TraceBuffer {
+    // Only updated by the recording thread
+    _Alignas(COOL_TRACE_CACHE_LINE) _Atomic uint64_t _tail;
+    _Atomic uint64_t _dropped;
+    _Atomic uint32_t _thread;
+
+    // Only updated by `Trace_flush`
+    _Alignas(COOL_TRACE_CACHE_LINE) _Atomic uint64_t _head;
+
+    struct TraceBuffer *_next;
+    _Atomic int _in_use;
+
+    TraceEvent _events[COOL_TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+static _Atomic int _trace_enabled;
+static FILE *_trace_stream;
+static struct timespec _trace_origin;
+static int _trace_first;
+static pid_t _trace_pid;
+
+// Every buffer ever acquired, only added to
+static _Atomic(TraceBuffer *) _trace_buffers;
+static atomic_uint _trace_threads;
+
+static pthread_mutex_t _trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _trace_key;
+static int _trace_key_ok;
+
+static _Thread_local TraceBuffer *_trace_buffer;
+
+/**
+ * Releases a thread's buffer when the thread exits, so that it
+ * can be reused by another thread. Its events are kept until
+ * they are flushed.
+ */
+static void _Trace_release(void *value) {
+    TraceBuffer *buffer = (TraceBuffer *) value;
+
+    atomic_store_explicit(&buffer->_in_use, 0, memory_order_release);
+}
+
+static void _Trace_key_init(void) {
+    _trace_key_ok = pthread_key_create(&_trace_key, _Trace_release) == 0;
+}
+
+/**
+ * Gets a buffer for the calling thread, either one released
+ * by an exited thread, or a newly allocated one.
+ */
+static TraceBuffer *_Trace_acquire(void) {
+    TraceBuffer *buffer;
+    TraceBuffer *head;
+    int in_use;
+
+    pthread_once(&_trace_once, _Trace_key_init);
+    if (!_trace_key_ok) return NULL;
+
+    // Try reusing a released buffer
+    buffer = atomic_load_explicit(&_trace_buffers, memory_order_acquire);
+
+    for (; buffer != NULL; buffer = buffer->_next) {
+        in_use = 0;
+
+        if (atomic_compare_exchange_strong_explicit(
+            &buffer->_in_use, &in_use, 1,
+            memory_order_acquire, memory_order_relaxed
+        )) {
+            break;
+        }
+    }
+
+    if (buffer == NULL) {
+        buffer = (TraceBuffer *) aligned_alloc(
+            _Alignof(TraceBuffer), sizeof(TraceBuffer)
+        );
+        if (buffer == NULL) return NULL;
+
+        atomic_init(&buffer->_tail, 0);
+        atomic_init(&buffer->_dropped, 0);
+        atomic_init(&buffer->_head, 0);
+        atomic_init(&buffer->_in_use, 1);
+
+        // Record the buffer, so that it can be flushed
+        head = atomic_load_explicit(&_trace_buffers, memory_order_relaxed);
+
+        do {
+            buffer->_next = head;
+        } while (!atomic_compare_exchange_weak_explicit(
+            &_trace_buffers, &head, buffer,
+            memory_order_release, memory_order_relaxed
+        ));
+    }
+
+    if (pthread_setspecific(_trace_key, buffer) != 0) {
+        _Trace_release(buffer);
+        return NULL;
+    }
+
+    // Number threads as they record their first event
+    atomic_store_explicit(
+        &buffer->_thread,
+        atomic_fetch_add(&_trace_threads, 1) + 1,
+        memory_order_relaxed
+    );
+    _trace_buffer = buffer;
+
+    return buffer;
+}
+
+/**
+ * Reads the clock events are timed with, which is monotonic
+ * if `CLOCK_MONOTONIC` is available, so that durations don't
+ * jump when the wall clock is changed.
+ */
+static void _Trace_clock(struct timespec *ts) {
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+    timespec_get(ts, TIME_UTC);
+#endif
+}
+
+/**
+ * Gets the nanoseconds since `Trace_start`.
+ */
+static uint64_t _Trace_time(void) {
+    struct timespec now;
+
+    _Trace_clock(&now);
+
+    return (uint64_t) (
+        (int64_t) (now.tv_sec - _trace_origin.tv_sec) * 1000000000
+        + (now.tv_nsec - _trace_origin.tv_nsec)
+    );
+}
+
+/**
+ * Writes a single event to the stream, as a JSON object.
+ */
+static void _Trace_write(const TraceEvent *event) {
+    fprintf(
+        _trace_stream,
+        "%s{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, "
+        "\"pid\": %ld, \"tid\": %lu",
+        _trace_first ? "\n" : ",\n",
+        event->_name, event->_phase, (double) event->_time / 1000,
+        (long) _trace_pid, (unsigned long) event->_thread
+    );
+
+    if (event->_phase == 'C') {
+        fprintf(
+            _trace_stream, ", \"args\": {\"value\": %lld}",
+            (long long) event->_value
+        );
+    }
+
+    fputs("}", _trace_stream);
+    _trace_first = 0;
+}
+
+/**
+ * Empties every buffer, writing their
+ * events if `write` is non-zero.
+ *
+ * The lock must be held.
+ */
+static void _Trace_drain(int write) {
+    TraceBuffer *buffer = atomic_load_explicit(
+        &_trace_buffers, memory_order_acquire
+    );
+    TraceEvent dropped;
+    TraceEvent *event;
+    uint64_t head;
+    uint64_t tail;
+
+    for (; buffer != NULL; buffer = buffer->_next) {
+        head = atomic_load_explicit(&buffer->_head, memory_order_relaxed);
+        tail = atomic_load_explicit(&buffer->_tail, memory_order_acquire);
+
+        for (; write && head != tail; head++) {
+            event = &buffer->_events[head & (COOL_TRACE_BUFFER_SIZE - 1)];
+            _Trace_write(event);
+        }
+
+        // Hand the slots back to the recording thread
+        atomic_store_explicit(&buffer->_head, tail, memory_order_release);
+
+        dropped._value = (int64_t) atomic_exchange_explicit(
+            &buffer->_dropped, 0, memory_order_relaxed
+        );
+
+        if (write && dropped._value != 0) {
+            dropped._time = _Trace_time();
+            dropped._name = "Trace dropped";
+            dropped._thread = atomic_load_explicit(
+                &buffer->_thread, memory_order_relaxed
+            );
+            dropped._phase = 'C';
+
+            _Trace_write(&dropped);
+        }
+    }
+}
+
+int Trace_start(FILE *stream) {
+    int result = -1;
+
+    pthread_mutex_lock(&_trace_lock);
+
+    if (_trace_stream == NULL && stream != NULL && fputs("[", stream) >= 0) {
+        // Discard events left over from an earlier trace
+        _Trace_drain(0);
+
+        _trace_stream = stream;
+        _trace_first = 1;
+        _trace_pid = getpid();
+        _Trace_clock(&_trace_origin);
+
+        atomic_store(&_trace_enabled, 1);
+        result = 0;
+    }
+
+    pthread_mutex_unlock(&_trace_lock);
+    return result;
+}
+
+int Trace_flush(void) {
+    int result = -1;
+
+    pthread_mutex_lock(&_trace_lock);
+
+    if (_trace_stream != NULL) {
+        _Trace_drain(1);
+        result = (fflush(_trace_stream) == 0) ? 0 : -1;
+    }
+
+    pthread_mutex_unlock(&_trace_lock);
+    return result;
+}
+
+void Trace_stop(void) {
+    atomic_store(&_trace_enabled, 0);
+
+    pthread_mutex_lock(&_trace_lock);
+
+    if (_trace_stream != NULL) {
+        _Trace_drain(1);
+        fputs("\n]\n", _trace_stream);
+        fflush(_trace_stream);
+        _trace_stream = NULL;
+    }
+
+    pthread_mutex_unlock(&_trace_lock);
+}
+
+void _Trace_event(int phase, const char *name, int64_t value) {
+    TraceBuffer *buffer = _trace_buffer;
+    TraceEvent *event;
+    uint64_t tail;
+
+    if (!atomic_load_explicit(&_trace_enabled, memory_order_acquire)) return;
+
+    if (buffer == NULL) {
+        buffer = _Trace_acquire();
+        if (buffer == NULL) return;
+    }
+
+    tail = atomic_load_explicit(&buffer->_tail, memory_order_relaxed);
+
+    // Drop the event if the buffer is full
+    if (tail - atomic_load_explicit(&buffer->_head, memory_order_acquire)
+        >= COOL_TRACE_BUFFER_SIZE) {
+        atomic_fetch_add_explicit(&buffer->_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    event = &buffer->_events[tail & (COOL_TRACE_BUFFER_SIZE - 1)];
+    event->_time = _Trace_time();
+    event->_name = name;
+    event->_value = value;
+    event->_thread = atomic_load_explicit(
+        &buffer->_thread, memory_order_relaxed
+    );
+    event->_phase = (char) phase;
+
+    // Publish the event to `Trace_flush`
+    atomic_store_explicit(&buffer->_tail, tail + 1, memory_order_release);
+}
+
+#endif // COOL_TRACE_IMPL
+
+#endif // _COOL_TRACE_H